@@ -54,6 +54,7 @@
 #ifndef AERA_EVENT_HPP
 #define AERA_EVENT_HPP
 
+#include <memory>
 #include <QPointF>
 #include "submodules/AERA/r_code/object.h"
 #include "submodules/AERA/r_exec/opcodes.h"
@@ -66,9 +67,7 @@ public:
   AeraEvent(int eventType, core::Timestamp time, r_code::Code* object)
   : eventType_(eventType),
     time_(time),
-    object_(object),
-    itemInitialTopLeftPosition_(qQNaN(), qQNaN()),
-    itemTopLeftPosition_(qQNaN(), qQNaN())
+    object_(object)
   {}
 
   virtual AeraEvent::~AeraEvent() {}
@@ -103,13 +102,55 @@ public:
     return reduction->get_reference(reduction->code(input_set_index + 2).asIndex());
   }
 
+  /**
+   * Get the item's initial top-left position, used by "Reset Position" to restore the initial placement.
+   * \return The position, or (NaN, NaN) if not set.
+   */
+  QPointF getItemInitialTopLeftPosition() const
+  {
+    return itemPositions_ ? itemPositions_->initialTopLeft_ : QPointF(qQNaN(), qQNaN());
+  }
+
+  void setItemInitialTopLeftPosition(const QPointF& position) { getItemPositions().initialTopLeft_ = position; }
+
+  /**
+   * Get the item's top-left position, used by "New" events to remember the screen position after undoing.
+   * \return The position, or (NaN, NaN) if not set.
+   */
+  QPointF getItemTopLeftPosition() const
+  {
+    return itemPositions_ ? itemPositions_->topLeft_ : QPointF(qQNaN(), qQNaN());
+  }
+
+  void setItemTopLeftPosition(const QPointF& position) { getItemPositions().topLeft_ = position; }
+
   int eventType_;
   core::Timestamp time_;
   r_code::Code* object_;
-  // itemOriginalTopLeftPosition_ is used by "Reset Position" to restore the initial placement.
-  QPointF itemInitialTopLeftPosition_;
-  // itemTopLeftPosition_ is used by "New" events to remember the screen position after undoing.
-  QPointF itemTopLeftPosition_;
+
+private:
+  /**
+   * ItemPositions has the positions of the event's item. Most events never get an item, so
+   * this is only allocated when a position is set.
+   */
+  struct ItemPositions {
+    ItemPositions()
+    : initialTopLeft_(qQNaN(), qQNaN()),
+      topLeft_(qQNaN(), qQNaN())
+    {}
+
+    QPointF initialTopLeft_;
+    QPointF topLeft_;
+  };
+
+  ItemPositions& getItemPositions()
+  {
+    if (!itemPositions_)
+      itemPositions_.reset(new ItemPositions());
+    return *itemPositions_;
+  }
+
+  std::unique_ptr<ItemPositions> itemPositions_;
 };
 
 class NewModelEvent : public AeraEvent {
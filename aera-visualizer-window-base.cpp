@@ -63,6 +63,8 @@ using namespace r_code;
 
 namespace aera_visualizer {
 
+const QString AeraVisulizerWindowBase::SettingsKeyPlaySpeed = "playSpeed";
+
 AeraVisulizerWindowBase::AeraVisulizerWindowBase(AeraVisulizerWindow* mainWindow, ReplicodeObjects& replicodeObjects)
 : QMainWindow(mainWindow),
   mainWindow_(mainWindow),
@@ -90,13 +92,9 @@ void AeraVisulizerWindowBase::createPlayerControlPanel()
   playerLayout->addWidget(stepBackButton_);
   playSlider_ = new QSlider(Qt::Horizontal, this);
   playSlider_->setMaximum(2000);
-#if 1
-  // Until we implement playSliderValueChanged, disable the slider so the user can't drag it.
-  // See https://github.com/IIIM-IS/AERA_Visualizer/issues/3 .
-  playSlider_->setEnabled(false);
-#else
+  // Only emit valueChanged when the user releases the slider, so that we seek once per drag.
+  playSlider_->setTracking(false);
   connect(playSlider_, SIGNAL(valueChanged(int)), this, SLOT(playSliderValueChanged(int)));
-#endif
   playerLayout->addWidget(playSlider_);
   stepButton_ = new QToolButton(this);
   stepButton_->setIcon(QIcon(":/images/play-step.png"));
@@ -108,6 +106,19 @@ void AeraVisulizerWindowBase::createPlayerControlPanel()
   connect(playTimeLabel_, SIGNAL(clicked()), this, SLOT(playTimeLabelClicked()));
   playerLayout->addWidget(playTimeLabel_);
 
+  playSpeedComboBox_ = new QComboBox(this);
+  const double playSpeeds[] = { 0.1, 0.25, 0.5, 1, 2, 5, 10, 100 };
+  QSettings settings;
+  double savedPlaySpeed = settings.value(SettingsKeyPlaySpeed, 1.0).toDouble();
+  for (size_t i = 0; i < sizeof(playSpeeds) / sizeof(playSpeeds[0]); ++i) {
+    playSpeedComboBox_->addItem(QString::number(playSpeeds[i]) + "x", playSpeeds[i]);
+    if (playSpeeds[i] == savedPlaySpeed)
+      playSpeedComboBox_->setCurrentIndex(i);
+  }
+  playSpeedComboBox_->setToolTip("Play speed");
+  connect(playSpeedComboBox_, SIGNAL(currentIndexChanged(int)), this, SLOT(playSpeedComboBoxIndexChanged(int)));
+  playerLayout->addWidget(playSpeedComboBox_);
+
   playerControlPanel_ = new QWidget();
   playerControlPanel_->setLayout(playerLayout);
 }
@@ -141,8 +152,11 @@ void AeraVisulizerWindowBase::stepBackButtonClicked()
 
 void AeraVisulizerWindowBase::playSliderValueChanged(int value)
 {
-  // TODO: Implement to check if the user moved the slider,
-  // stopPlay, update the play time.
+  if (mainWindow_)
+    mainWindow_->playSliderValueChangedImpl(value);
+  else
+    // This is the main window.
+    ((AeraVisulizerWindow*)this)->playSliderValueChangedImpl(value);
 }
 
 void AeraVisulizerWindowBase::playTimeLabelClicked()
@@ -154,6 +168,15 @@ void AeraVisulizerWindowBase::playTimeLabelClicked()
     ((AeraVisulizerWindow*)this)->playTimeLabelClickedImpl();
 }
 
+void AeraVisulizerWindowBase::playSpeedComboBoxIndexChanged(int index)
+{
+  if (mainWindow_)
+    mainWindow_->playSpeedComboBoxIndexChangedImpl(index);
+  else
+    // This is the main window.
+    ((AeraVisulizerWindow*)this)->playSpeedComboBoxIndexChangedImpl(index);
+}
+
 ClickableLabel::ClickableLabel(const QString& text, QWidget* parent, Qt::WindowFlags f)
   : QLabel(text, parent) {}
 
@@ -59,6 +59,7 @@
 #include <QPushButton>
 #include <QToolButton>
 #include <QSlider>
+#include <QComboBox>
 #include <QLabel>
 #include "submodules/AERA/r_code/utils.h"
 #include "replicode-objects.hpp"
@@ -118,6 +119,7 @@ private slots:
   void stepBackButtonClicked();
   void playSliderValueChanged(int value);
   void playTimeLabelClicked();
+  void playSpeedComboBoxIndexChanged(int index);
 
 private:
   friend class AeraVisulizerWindow;
@@ -130,6 +132,10 @@ private:
   QToolButton* stepButton_;
   QSlider* playSlider_;
   ClickableLabel* playTimeLabel_;
+  // The item data is the play speed as a multiple of real time.
+  QComboBox* playSpeedComboBox_;
+
+  static const QString SettingsKeyPlaySpeed;
 
   std::vector<AeraVisulizerWindowBase*> children_;
   QWidget* playerControlPanel_;
@@ -52,8 +52,11 @@
 //_/_/ 
 //_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/
 
-#include <fstream>
+#include <cstring>
 #include <algorithm>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 #include "submodules/AERA/r_exec/opcodes.h"
 #include "graphics-items/arrow.hpp"
 #include "graphics-items/model-item.hpp"
@@ -76,6 +79,7 @@
 #include "graphics-items/promoted-prediction-item.hpp"
 #include "graphics-items/promoted-prediction-defeated-item.hpp"
 #include "graphics-items/aera-visualizer-scene.hpp"
+#include "event-cache.hpp"
 #include "aera-visualizer-window.hpp"
 #include "aera-checkbox.h"
 
@@ -140,6 +144,22 @@ const set<int> AeraVisulizerWindow::newItemEventTypes_ = {
   PromotedSimulatedPredictionEvent::EVENT_TYPE,
   PromotedSimulatedPredictionDefeatEvent::EVENT_TYPE };
 
+vector<uint8> AeraVisulizerWindow::makeStepKinds()
+{
+  // EventStore keeps the event type in a uint8.
+  vector<uint8> stepKinds(256, STEP_SKIP);
+  for (auto eventType = newItemEventTypes_.begin(); eventType != newItemEventTypes_.end(); ++eventType)
+    stepKinds[*eventType] = STEP_NEW_ITEM;
+  stepKinds[SetModelEvidenceCountAndSuccessRateEvent::EVENT_TYPE] = STEP_MODEL_STATE;
+  stepKinds[SetModelStrengthEvent::EVENT_TYPE] = STEP_MODEL_STATE;
+  stepKinds[PhaseInModelEvent::EVENT_TYPE] = STEP_MODEL_STATE;
+  stepKinds[PhaseOutModelEvent::EVENT_TYPE] = STEP_MODEL_STATE;
+  stepKinds[DeleteModelEvent::EVENT_TYPE] = STEP_MODEL_STATE;
+  return stepKinds;
+}
+
+const vector<uint8> AeraVisulizerWindow::stepKinds_ = makeStepKinds();
+
 const QString AeraVisulizerWindow::SettingsKeyAutoScroll = "AutoScroll";
 const QString AeraVisulizerWindow::SettingsKeySimulationsVisible = "simulationsVisible";
 const QString AeraVisulizerWindow::SettingsKeyNonSimulationsVisible = "nonSimulationsVisible";
@@ -147,6 +167,7 @@ const QString AeraVisulizerWindow::SettingsKeyEssenceFactsVisible = "essenceFact
 const QString AeraVisulizerWindow::SettingsKeyInstantiatedCompositeStatesVisible = "instantiatedCompositeStatesVisible";
 const QString AeraVisulizerWindow::SettingsKeyPredictedInstantiatedCompositeStatesVisible = "predictedInstantiatedCompositeStatesVisible";
 const QString AeraVisulizerWindow::SettingsKeyRequirementsVisible = "requirementsVisible";
+const QString AeraVisulizerWindow::SettingsKeyKeyframeInterval = "keyframeInterval";
 
 AeraVisulizerWindow::AeraVisulizerWindow(ReplicodeObjects& replicodeObjects)
 : AeraVisulizerWindowBase(0, replicodeObjects),
@@ -158,6 +179,8 @@ AeraVisulizerWindow::AeraVisulizerWindow(ReplicodeObjects& replicodeObjects)
   playTime_(seconds(0)),
   playTimerId_(0),
   isPlaying_(false),
+  playClockStartTime_(seconds(0)),
+  isInPlayTimerEvent_(false),
   itemBorderHighlightPen_(Qt::blue, 3)
 {
   createActions();
@@ -205,461 +228,460 @@ AeraVisulizerWindow::AeraVisulizerWindow(ReplicodeObjects& replicodeObjects)
 
 bool AeraVisulizerWindow::addEvents(const string& runtimeOutputFilePath, QProgressDialog& progress)
 {
-  // load mdl 37, MDLController(113)
-  regex loadModelRegex("^load mdl (\\d+), MDLController\\((\\d+)\\) strength:([\\d\\.]+) cnt:(\\d+) sr:([\\d\\.]+)$");
-  // load cst 36, CSTController(98)
-  regex loadCompositeStateRegex("^load cst (\\d+), CSTController\\((\\d+)\\)$");
-
-  // The remaining regex expressions all start with a timestamp.
-  regex timestampRegex("^(\\d+)s:(\\d+)ms:(\\d+)us (.+)$");
-
-  // -> mdl 53, MDLController(389)
-  regex newModelRegex("^-> mdl (\\d+), MDLController\\((\\d+)\\)$");
-  // mdl 53 cnt:2 sr:1
-  regex setEvidenceCountAndSuccessRateRegex("^mdl (\\d+) cnt:(\\d+) sr:([\\d\\.]+)$");
-  // mdl 75 strength:1
-  regex setStrengthRegex("^mdl (\\d+) strength:([\\d\\.]+)$");
-  // mdl 53 deleted
-  // mdl 53 phased in
-  // mdl 53 phased out
-  regex deleteOrPhaseInOrOutModelRegex("^mdl (\\d+) (deleted|phased in|phased out)$");
-  // -> cst 52, CSTController(375)
-  regex newCompositeStateRegex("^-> cst (\\d+), CSTController\\((\\d+)\\)$");
-  // A/F -> 35|40 (AXIOM)
-  regex autofocusNewObjectRegex("^A/F -> (\\d+)\\|(\\d+) \\((\\w+)\\)$");
-  // mdl 61 predict imdl -> mk.rdx 559
-  regex modelImdlPredictionReductionRegex("^mdl \\d+ predict imdl -> mk.rdx (\\d+)$");
-  // mdl 67: fact (352225) pred fact imdl -> fact 588 simulated pred, from goal req 533
-  regex modelSimulatedPredictionFromGoalRequirementRegex("^mdl (\\d+): fact \\((\\d+)\\) pred fact imdl -> fact (\\d+) simulated pred, from goal req (\\d+)$");
-  // mdl 67: fact (697996) pred fact imdl, from goal req 1250, simulated pred disabled by fact (696754) pred |fact imdl
-  regex modelPredictionDisabledByStrongRequirementRegex("^mdl (\\d+): fact \\((\\d+)\\) pred fact imdl(, from goal req (\\d+))?, (simulated )?pred disabled by fact \\((\\d+)\\) pred \\|fact imdl$");
-  // mdl 63 predict -> mk.rdx 68
-  regex modelPredictionReductionRegex("^mdl \\d+ predict -> mk.rdx (\\d+)$");
-  // mdl 41 abduce -> mk.rdx 97
-  regex modelAbductionReductionRegex("^mdl \\d+ abduce -> mk.rdx (\\d+)$");
-  // mdl 64: fact 96 super_goal -> fact 98 simulated goal
-  regex modelSimulatedAbductionRegex("^mdl (\\d+): fact (\\d+) super_goal -> fact (\\d+) simulated goal$");
-  // cst 64: fact 96 super_goal -> fact 98 simulated goal
-  regex compositeStateSimulatedAbductionRegex("^cst (\\d+): fact (\\d+) super_goal -> fact (\\d+) simulated goal$");
-  // mdl 57: fact 202 pred -> fact 227 simulated pred
-  // mdl 57: fact 202 pred -> fact 227 simulated pred, using req (745971)
-  // mdl 57: fact 202 pred -> fact 227 simulated pred fact imdl, using req (745971)
-  regex modelSimulatedPredictionRegex("^mdl (\\d+): fact (\\d+) pred -> fact (\\d+) simulated pred( fact imdl)?(?:, using req \\((\\d+)\\))?$");
-  // mdl 63: fact 531 super_goal -> fact (332278) simulated pred start, using req (323845), ijt 0s:535ms:0us
-  regex modelSimulatedPredictionStartRegex("^mdl (\\d+): fact (\\d+) super_goal -> fact \\((\\d+)\\) simulated pred start(?:, using req \\((\\d+)\\))?, ijt (\\d+)s:(\\d+)ms:(\\d+)us$");
-  // cst 60: fact 195 -> fact 218 simulated pred fact icst [ 155 191]
-  regex compositeStateSimulatedPredictionRegex("^cst (\\d+): fact (\\d+) -> fact (\\d+) simulated pred fact icst \\[([ \\d]+)\\]$");
-  // fact 59 icst[52][ 50 55]
-  regex newInstantiatedCompositeStateRegex("^fact (\\d+) icst\\[\\d+\\]\\[([ \\d]+)\\]$");
-  // fact 59 pred fact (193775) icst[52][ 50 55]
-  regex newPredictedInstantiatedCompositeStateRegex("^fact (\\d+) pred fact \\(\\d+\\) icst\\[\\d+\\]\\[([ \\d]+)\\]$");
-  // fact 75 -> fact 79 success fact 60 pred
-  regex predictionSuccessRegex("^fact (\\d+) -> fact (\\d+) success fact \\d+ pred$");
-  // |fact 72 fact 59 pred failure
-  regex predictionFailureRegex("^\\|fact (\\d+) fact \\d+ pred failure$");
-  // fact 121: 96 goal success (TopLevel)
-  regex topLevelGoalSuccessRegex("^fact (\\d+): (\\d+) goal success \\(TopLevel\\)$");
-  // I/O device inject 46, ijt 0s:200ms:0us
-  regex ioDeviceInjectRegex("^I/O device inject (\\d+), ijt (\\d+)s:(\\d+)ms:(\\d+)us$");
-  // mk.rdx(100): I/O device eject 39
-  regex ioDeviceEjectWithRdxRegex("^mk.rdx\\((\\d+)\\): I/O device eject (\\d+)$");
-  // I/O device eject 39
-  regex ioDeviceEjectWithoutRdxRegex("^I/O device eject (\\d+)$");
-  // -> drive 158, ijt 0s:310ms:0us
-  regex driveInjectRegex("^-> drive (\\d+), ijt (\\d+)s:(\\d+)ms:(\\d+)us$");
-  // sim commit: fact 238 pred fact success -> fact (82115) goal
-  regex simulationCommitRegex("^sim commit: fact (\\d+) pred fact success -> fact \\((\\d+)\\) goal$");
-  // fact 182 -> promoted simulated pred fact 250 w/ fact 247 timings
-  regex simulationPromotedSimulatedPredictionRegex("^fact (\\d+) -> promoted simulated pred fact (\\d+) w/ fact (\\d+) timings$");
-  // promoted simulated fact 251 defeated by fact 253
-  regex simulationPromotedSimulatedPredictionDefeatedRegex("^promoted simulated fact (\\d+) defeated by fact (\\d+)");
-
   progress.setLabelText(replicodeObjects_.getProgressLabelText("Reading runtime output"));
 
-  // Count the number of lines, to use in the progress dialog.
-  int nLines;
-  {
-    ifstream fileForCount(runtimeOutputFilePath);
-    nLines = std::count(istreambuf_iterator<char>(fileForCount), istreambuf_iterator<char>(), '\n');
-  }
-  progress.setMaximum(nLines);
-
-  // pendingEvents is an ordered map keyed by event time. The value is a list of pending events at the time.
-  std::map<core::Timestamp, vector<shared_ptr<AeraEvent> > > pendingEvents;
-  ifstream runtimeOutputFile(runtimeOutputFilePath);
-  int lineNumber = 0;
-  string line;
-  while (getline(runtimeOutputFile, line)) {
-    if (progress.wasCanceled())
-      return false;
-
-    ++lineNumber;
-    progress.setValue(lineNumber);
-    if (lineNumber % 100 == 0)
-      QApplication::processEvents();
-
-    smatch matches;
-
-    if (regex_search(line, matches, loadModelRegex)) {
-      auto model = replicodeObjects_.getObject(stoul(matches[1].str()));
-      if (model) {
-        // Restore the initial count, success rate and strength.
-        core::float32 strength = stof(matches[3].str());
-        core::float32 evidenceCount = stol(matches[4].str());
-        core::float32 successRate = stof(matches[5].str());
-        model->code(MDL_STRENGTH) = Atom::Float(strength);
-        model->code(MDL_CNT) = Atom::Float(evidenceCount);
-        model->code(MDL_SR) = Atom::Float(successRate);
-        startupEvents_.push_back(make_shared <NewModelEvent>(
-          replicodeObjects_.getTimeReference(), model, strength, evidenceCount, successRate, stoll(matches[2].str())));
+  vector<string> cacheInputFilePaths;
+  if (eventCacheFilePath_ != "") {
+    // The events depend on the runtime output and on the objects that it refers to.
+    cacheInputFilePaths.push_back(runtimeOutputFilePath);
+    cacheInputFilePaths.insert(
+      cacheInputFilePaths.end(), eventCacheInputFilePaths_.begin(), eventCacheInputFilePaths_.end());
+    if (EventCache::read(eventCacheFilePath_, cacheInputFilePaths, replicodeObjects_, startupEvents_, events_)) {
+      for (size_t i = 0; i < events_.size(); ++i) {
+        if (events_.getType(i) == ModelImdlPredictionEvent::EVENT_TYPE)
+          imdlPredictionEventIndexes_[events_.getObject(i)] = i;
       }
-
-      continue;
+      indexEvents();
+      return true;
     }
-    else if (regex_search(line, matches, loadCompositeStateRegex)) {
-      auto compositeState = replicodeObjects_.getObject(stoul(matches[1].str()));
-      if (compositeState)
-        startupEvents_.push_back(make_shared <NewCompositeStateEvent>(
-          replicodeObjects_.getTimeReference(), compositeState, stoll(matches[2].str())));
+  }
 
-      continue;
+  // Map the file into memory so that we scan it once and use each line in place.
+  QFile runtimeOutputFile(QString::fromStdString(runtimeOutputFilePath));
+  if (!runtimeOutputFile.open(QIODevice::ReadOnly))
+    return false;
+  qint64 fileSize = runtimeOutputFile.size();
+  const char* fileData = 0;
+  QByteArray fileContents;
+  if (fileSize > 0) {
+    fileData = (const char*)runtimeOutputFile.map(0, fileSize);
+    if (!fileData) {
+      // We can't map the file, so read it all.
+      fileContents = runtimeOutputFile.readAll();
+      fileData = fileContents.constData();
+      fileSize = fileContents.size();
     }
+  }
+  if (fileSize == 0)
+    return true;
+  const char* fileEnd = fileData + fileSize;
+
+  // The progress value is the byte offset, scaled to fit in an int.
+  const int progressMaximum = 1000;
+  progress.setMaximum(progressMaximum);
+
+  // Split the file at line boundaries into a chunk for each thread. Don't bother with
+  // threads for small chunks.
+  const qint64 minimumChunkSize = 1000000;
+  size_t nChunks = max(1u, thread::hardware_concurrency());
+  nChunks = (size_t)max((qint64)1, min((qint64)nChunks, fileSize / minimumChunkSize));
+  vector<const char*> chunkBegin(nChunks + 1);
+  chunkBegin[0] = fileData;
+  chunkBegin[nChunks] = fileEnd;
+  for (size_t i = 1; i < nChunks; ++i) {
+    const char* begin = max(chunkBegin[i - 1], fileData + fileSize * i / nChunks);
+    // Start the chunk after the next newline.
+    const char* newline = (const char*)memchr(begin, '\n', fileEnd - begin);
+    chunkBegin[i] = (newline ? newline + 1 : fileEnd);
+  }
 
-    // The remaining regex expressions all start with a timestamp.
-    if (!regex_search(line, matches, timestampRegex))
-      continue;
-    core::Timestamp timestamp = getTimestamp(matches);
-    string lineAfterTimestamp = matches[4].str();
-
-    while (pendingEvents.size() >= 1 && pendingEvents.begin()->first <= timestamp) {
-      // Insert the pending event before this new event.
-      for (int i = 0; i < pendingEvents.begin()->second.size(); ++i)
-        events_.push_back(pendingEvents.begin()->second[i]);
-      pendingEvents.erase(pendingEvents.begin());
-    }
+  // Parse each chunk in its own thread.
+  vector<vector<RuntimeOutputEntry<AeraEvent> > > chunkEntries(nChunks);
+  vector<atomic<int64> > chunkBytesParsed(nChunks);
+  atomic<size_t> nChunksFinished(0);
+  atomic<bool> canceled(false);
+  vector<thread> threads;
+  for (size_t i = 0; i < nChunks; ++i) {
+    chunkBytesParsed[i] = 0;
+    threads.push_back(thread([&, i]() {
+      parseRuntimeOutputChunk<AeraEvent>(
+        chunkBegin[i], chunkBegin[i + 1], replicodeObjects_.getTimeReference(),
+        [this](const RuntimeOutputLine& line) { return newAeraEvent(line); },
+        chunkEntries[i], chunkBytesParsed[i], canceled);
+      ++nChunksFinished;
+    }));
+  }
 
-    if (regex_search(lineAfterTimestamp, matches, newModelRegex)) {
-      auto model = replicodeObjects_.getObject(stoul(matches[1].str()));
-      if (model)
-        // Use the strength, count and success rate as initialized in _TPX::build_mdl_tail.
-        events_.push_back(make_shared<NewModelEvent>(
-          timestamp, model, 0, 1, 1, stoll(matches[2].str())));
-    }
-    else if (regex_search(lineAfterTimestamp, matches, setEvidenceCountAndSuccessRateRegex)) {
-      auto model = replicodeObjects_.getObject(stoul(matches[1].str()));
-      if (model)
-        events_.push_back(make_shared<SetModelEvidenceCountAndSuccessRateEvent>(
-          timestamp, model, stol(matches[2].str()), stof(matches[3].str())));
-    }
-    else if (regex_search(lineAfterTimestamp, matches, setStrengthRegex)) {
-      auto model = replicodeObjects_.getObject(stoul(matches[1].str()));
-      if (model)
-        events_.push_back(make_shared<SetModelStrengthEvent>(
-          timestamp, model, stof(matches[2].str())));
-    }
-    else if (regex_search(lineAfterTimestamp, matches, deleteOrPhaseInOrOutModelRegex)) {
-      auto model = replicodeObjects_.getObject(stoul(matches[1].str()));
-      if (model) {
-        if (matches[2] == "phased in")
-          events_.push_back(make_shared<PhaseInModelEvent>(timestamp, model));
-        if (matches[2] == "phased out")
-          events_.push_back(make_shared<PhaseOutModelEvent>(timestamp, model));
-        else if (matches[2] == "deleted")
-          events_.push_back(make_shared<DeleteModelEvent>(timestamp, model));
-      }
-    }
-    else if (regex_search(lineAfterTimestamp, matches, newCompositeStateRegex)) {
-      auto compositeState = replicodeObjects_.getObject(stoul(matches[1].str()));
-      if (compositeState)
-        events_.push_back(make_shared<NewCompositeStateEvent>(
-          timestamp, compositeState, stoll(matches[2].str())));
-    }
-    else if (regex_search(lineAfterTimestamp, matches, autofocusNewObjectRegex)) {
-      auto fromObject = replicodeObjects_.getObject(stoul(matches[1].str()));
-      auto toObject = replicodeObjects_.getObject(stoul(matches[2].str()));
-      // Skip auto-focus of the same fact (such as eject facts).
-      // But show auto-focus of the same anti-fact (such as prediction failure).
-      if (fromObject && toObject /*debug && !(fromObject == toObject && fromObject->code(0).asOpcode() == Opcodes::Fact) */)
-        events_.push_back(make_shared<AutoFocusNewObjectEvent>(
-          timestamp, fromObject, toObject, matches[3].str()));
-    }
-    else if (regex_search(lineAfterTimestamp, matches, modelImdlPredictionReductionRegex)) {
-      auto reduction = replicodeObjects_.getObject(stoul(matches[1].str()));
-      if (reduction) {
-        auto factImdl = reduction->get_reference(MK_RDX_IHLP_REF);
-        auto model = factImdl->get_reference(0)->get_reference(0);
-        // The super goal is the first (only) item in the set of inputs.
-        auto cause = reduction->get_reference(
-          reduction->code(reduction->code(MK_RDX_INPUTS).asIndex() + 1).asIndex());
-        // The prediction is the first (only) item in the set of productions.
-        auto factPred = AeraEvent::getFirstProduction(reduction);
-
-        if (model && cause && factPred) {
-          if (((_Fact*)factPred)->get_pred()->is_simulation())
-            events_.push_back(make_shared<ModelSimulatedPredictionReduction>(
-              timestamp, model, factPred, cause, (Code*)NULL, false, false));
-          else
-            events_.push_back(make_shared<ModelImdlPredictionEvent>(
-              timestamp, factPred, model, cause));
-        }
-      }
-    }
-    else if (regex_search(lineAfterTimestamp, matches, modelSimulatedPredictionFromGoalRequirementRegex)) {
-      auto model = replicodeObjects_.getObject(stoul(matches[1].str()));
-      auto factPred = replicodeObjects_.getObject(stoul(matches[3].str()));
-      auto input = replicodeObjects_.getObjectByDetailOid(stoul(matches[2].str()));
-      auto goal_requirement = replicodeObjects_.getObject(stoul(matches[4].str()));
-
-      if (model && factPred && input && goal_requirement)
-        events_.push_back(make_shared<ModelSimulatedPredictionReductionFromGoalRequirement>(
-          timestamp, model, factPred, input, goal_requirement));
-    }
-    else if (regex_search(lineAfterTimestamp, matches, modelPredictionDisabledByStrongRequirementRegex)) {
-      auto model = replicodeObjects_.getObject(stoul(matches[1].str()));
-      auto input = replicodeObjects_.getObjectByDetailOid(stoul(matches[2].str()));
-      Code* goal_requirement = 0;
-      if (matches[4].length() > 0)
-        goal_requirement = replicodeObjects_.getObject(stoul(matches[4].str()));
-      auto strong_requirement = replicodeObjects_.getObjectByDetailOid(stoul(matches[6].str()));
-
-      if (model && input && strong_requirement)
-        events_.push_back(make_shared<ModelPredictionFromRequirementDisabledEvent>(
-          timestamp, model, input, goal_requirement, strong_requirement));
+  while (nChunksFinished < nChunks) {
+    if (progress.wasCanceled()) {
+      canceled = true;
+      break;
     }
-    else if (regex_search(lineAfterTimestamp, matches, modelPredictionReductionRegex)) {
-      auto reduction = replicodeObjects_.getObject(stoul(matches[1].str()));
-      if (reduction) {
-        // Check the type of prediction.
-        auto factPred = AeraEvent::getFirstProduction(reduction);
-        auto pred = factPred->get_reference(0);
-        auto factValue = pred->get_reference(0);
-        auto value = factValue->get_reference(0);
-        auto valueOpcode = value->code(0).asOpcode();
-
-        if (valueOpcode == Opcodes::MkVal) {
-          int imdlPredictionEventIndex = -1;
-          auto requirement = AeraEvent::getSecondInput(reduction);
-          if (requirement) {
-            // Search events_ backwards for the previous prediction whose object_ is this->getRequirement().
-            for (int i = events_.size() - 1; i >= 0; --i) {
-              if (events_[i]->eventType_ == ModelImdlPredictionEvent::EVENT_TYPE &&
-                  ((ModelImdlPredictionEvent*)events_[i].get())->object_ == requirement) {
-                imdlPredictionEventIndex = i;
-                break;
-              }
-            }
-          }
 
-          events_.push_back(make_shared<ModelMkValPredictionReduction>(
-            timestamp, reduction, imdlPredictionEventIndex));
-        }
-      }
-    }
-    else if (regex_search(lineAfterTimestamp, matches, modelAbductionReductionRegex)) {
-      auto reduction = replicodeObjects_.getObject(stoul(matches[1].str()));
-      if (reduction) {
-        auto factImdl = reduction->get_reference(MK_RDX_IHLP_REF);
-        auto model = factImdl->get_reference(0)->get_reference(0);
-        // The goal is the first (only) item in the set of productions.
-        auto factGoal = AeraEvent::getFirstProduction(reduction);
-        // The super goal is the first item in the set of inputs.
-        auto factSuperGoal = reduction->get_reference(
-          reduction->code(reduction->code(MK_RDX_INPUTS).asIndex() + 1).asIndex());
-        events_.push_back(make_shared<ModelGoalReduction>(
-          timestamp, model, factGoal, factSuperGoal));
-      }
-    }
-    else if (regex_search(lineAfterTimestamp, matches, modelSimulatedAbductionRegex)) {
-      auto model = replicodeObjects_.getObject(stoul(matches[1].str()));
-      auto factGoal = replicodeObjects_.getObject(stoul(matches[3].str()));
-      auto factSuperGoal = replicodeObjects_.getObject(stoul(matches[2].str()));
-      if (model && factGoal && factSuperGoal)
-        events_.push_back(make_shared<ModelGoalReduction>(
-          timestamp, model, factGoal, factSuperGoal));
-    }
-    else if (regex_search(lineAfterTimestamp, matches, compositeStateSimulatedAbductionRegex)) {
-      auto compositeState = replicodeObjects_.getObject(stoul(matches[1].str()));
-      auto factGoal = replicodeObjects_.getObject(stoul(matches[3].str()));
-      auto factSuperGoal = replicodeObjects_.getObject(stoul(matches[2].str()));
-      if (compositeState && factGoal && factSuperGoal)
-        events_.push_back(make_shared<CompositeStateGoalReduction>(
-          timestamp, compositeState, factGoal, factSuperGoal));
-    }
-    else if (regex_search(lineAfterTimestamp, matches, modelSimulatedPredictionRegex)) {
-      auto model = replicodeObjects_.getObject(stoul(matches[1].str()));
-      auto input = replicodeObjects_.getObject(stoul(matches[2].str()));
-      auto factPred = replicodeObjects_.getObject(stoul(matches[3].str()));
-      bool factPredIsImdl = (matches[4] == " fact imdl");
-      Code* requirement = 0;
-      if (matches[5].length() > 0)
-        requirement = replicodeObjects_.getObjectByDetailOid(stoul(matches[5].str()));
-
-      if (model && factPred && input)
-        events_.push_back(make_shared<ModelSimulatedPredictionReduction>(
-          timestamp, model, factPred, input, requirement, false, factPredIsImdl));
+    qint64 bytesParsed = 0;
+    for (size_t i = 0; i < nChunks; ++i)
+      bytesParsed += chunkBytesParsed[i];
+    progress.setValue((int)(bytesParsed * progressMaximum / fileSize));
+    QApplication::processEvents();
+    this_thread::sleep_for(milliseconds(20));
+  }
+  for (size_t i = 0; i < threads.size(); ++i)
+    threads[i].join();
+  if (canceled)
+    return false;
+  progress.setValue(progressMaximum);
+
+  // Merge the chunks in order. This is the only place which changes events_, so it can
+  // do what needs the previous events, across chunk boundaries.
+  auto addStartupEvent = [&](RuntimeOutputLine::Type type, unique_ptr<AeraEvent> event) {
+    if (type == RuntimeOutputLine::LOAD_MODEL) {
+      auto newModelEvent = (NewModelEvent*)event.get();
+      // Restore the initial count, success rate and strength.
+      event->object_->code(MDL_STRENGTH) = Atom::Float(newModelEvent->strength_);
+      event->object_->code(MDL_CNT) = Atom::Float(newModelEvent->evidenceCount_);
+      event->object_->code(MDL_SR) = Atom::Float(newModelEvent->successRate_);
     }
-    else if (regex_search(lineAfterTimestamp, matches, modelSimulatedPredictionStartRegex)) {
-      auto model = replicodeObjects_.getObject(stoul(matches[1].str()));
-      auto input = replicodeObjects_.getObject(stoul(matches[2].str()));
-      auto factPred = replicodeObjects_.getObjectByDetailOid(stoul(matches[3].str()));
-      Code* requirement = 0;
-      if (matches[4].length() > 0)
-        requirement = replicodeObjects_.getObjectByDetailOid(stoul(matches[4].str()));
-
-      if (model && factPred && input) {
-        core::Timestamp injectionTime = getTimestamp(matches, 5);
-        if (injectionTime < timestamp)
-          // We don't expect this, but the runtime would not have injected earlier.
-          injectionTime = timestamp;
-        // TODO: Use an AeraEvent with the details of starting the simulated forward chaining, and include requirement.
-        auto event = make_shared<ModelSimulatedPredictionReduction>(injectionTime, model, factPred, input, requirement, true, false);
-        // Put in pendingEvents to be added to events_ later.
-        if (pendingEvents.find(event->time_) == pendingEvents.end())
-          // Create the entry.
-          pendingEvents[event->time_] = vector<shared_ptr<AeraEvent> >();
-        pendingEvents[event->time_].push_back(event);
-      }
+    startupEvents_.push_back(move(event));
+  };
+  auto addEvent = [&](unique_ptr<AeraEvent> event) {
+    if (event->eventType_ == ModelMkValPredictionReduction::EVENT_TYPE) {
+      auto mkValPrediction = (ModelMkValPredictionReduction*)event.get();
+      mkValPrediction->imdlPredictionEventIndex_ = getImdlPredictionEventIndex(mkValPrediction->getRequirement());
     }
-    else if (regex_search(lineAfterTimestamp, matches, compositeStateSimulatedPredictionRegex)) {
-      auto compositeState = replicodeObjects_.getObject(stoul(matches[1].str()));
-      auto factPred = replicodeObjects_.getObject(stoul(matches[3].str()));
-      auto input = replicodeObjects_.getObject(stoul(matches[2].str()));
-
-      // Get the matching inputs.
-      string inputOids = matches[4].str();
-      vector<Code*> inputs;
-      bool gotAllInputs = true;
-      while (regex_search(inputOids, matches, regex("( \\d+)"))) {
-        auto input = replicodeObjects_.getObject(stoul(matches[1].str()));
-        if (!input) {
-          gotAllInputs = false;
-          break;
-        }
-        inputs.push_back(input);
-
-        inputOids = matches.suffix();
-      }
+    else if (event->eventType_ == ModelImdlPredictionEvent::EVENT_TYPE)
+      // Replace any previous prediction with the same object.
+      imdlPredictionEventIndexes_[event->object_] = events_.size();
+
+    events_.push_back(move(event));
+  };
+  RuntimeOutputMerger<AeraEvent> merger;
+  for (size_t iChunk = 0; iChunk < nChunks; ++iChunk) {
+    vector<RuntimeOutputEntry<AeraEvent> >& entries = chunkEntries[iChunk];
+    for (size_t iEntry = 0; iEntry < entries.size(); ++iEntry)
+      merger.add(entries[iEntry], addStartupEvent, addEvent);
+
+    // Free the chunk's entries as we go.
+    vector<RuntimeOutputEntry<AeraEvent> >().swap(entries);
+  }
+  // Add any remaining pending events.
+  merger.finish(addEvent);
 
-      if (compositeState && factPred && input && gotAllInputs)
-        events_.push_back(make_shared<CompositeStateSimulatedPredictionReduction>(
-          timestamp, compositeState, factPred, input, inputs));
-    }
-    else if (regex_search(lineAfterTimestamp, matches, newInstantiatedCompositeStateRegex)) {
-      auto instantiatedCompositeState = replicodeObjects_.getObject(stoul(matches[1].str()));
-
-      // Get the matching inputs.
-      string inputOids = matches[2].str();
-      vector<Code*> inputs;
-      bool gotAllInputs = true;
-      while (regex_search(inputOids, matches, regex("( \\d+)"))) {
-        auto input = replicodeObjects_.getObject(stoul(matches[1].str()));
-        if (!input) {
-          gotAllInputs = false;
-          break;
-        }
-        inputs.push_back(input);
+  if (eventCacheFilePath_ != "")
+    // Ignore an error. We will parse the runtime output again next time.
+    EventCache::write(eventCacheFilePath_, cacheInputFilePaths, replicodeObjects_, startupEvents_, events_);
 
-        inputOids = matches.suffix();
-      }
+  indexEvents();
+  return true;
+}
 
-      if (instantiatedCompositeState && gotAllInputs)
-        events_.push_back(make_shared<NewInstantiatedCompositeStateEvent>(
-          timestamp, instantiatedCompositeState, inputs));
-    }
-    else if (regex_search(lineAfterTimestamp, matches, newPredictedInstantiatedCompositeStateRegex)) {
-      auto f_p_f_icst = replicodeObjects_.getObject(stoul(matches[1].str()));
-
-      // Get the matching inputs.
-      string inputOids = matches[2].str();
-      vector<Code*> inputs;
-      bool gotAllInputs = true;
-      while (regex_search(inputOids, matches, regex("( \\d+)"))) {
-        auto input = replicodeObjects_.getObject(stoul(matches[1].str()));
-        if (!input) {
-          gotAllInputs = false;
-          break;
-        }
-        inputs.push_back(input);
+unique_ptr<AeraEvent> AeraVisulizerWindow::newAeraEvent(const RuntimeOutputLine& line) const
+{
+  const uint64* id = line.id_;
+
+  if (line.type_ == RuntimeOutputLine::LOAD_MODEL) {
+    auto model = replicodeObjects_.getObject(id[0]);
+    if (model)
+      return make_unique<NewModelEvent>(
+        replicodeObjects_.getTimeReference(), model, line.strength_, line.evidenceCount_, line.successRate_, id[1]);
+    return unique_ptr<AeraEvent>();
+  }
+  else if (line.type_ == RuntimeOutputLine::LOAD_COMPOSITE_STATE) {
+    auto compositeState = replicodeObjects_.getObject(id[0]);
+    if (compositeState)
+      return make_unique<NewCompositeStateEvent>(
+        replicodeObjects_.getTimeReference(), compositeState, id[1]);
+    return unique_ptr<AeraEvent>();
+  }
 
-        inputOids = matches.suffix();
+  // The remaining lines all start with a timestamp.
+  if (!line.hasTimestamp_)
+    return unique_ptr<AeraEvent>();
+  core::Timestamp timestamp = replicodeObjects_.getTimeReference() + line.time_;
+
+  switch (line.type_) {
+  case RuntimeOutputLine::NEW_MODEL: {
+    auto model = replicodeObjects_.getObject(id[0]);
+    if (model)
+      // Use the strength, count and success rate as initialized in _TPX::build_mdl_tail.
+      return make_unique<NewModelEvent>(
+        timestamp, model, 0, 1, 1, id[1]);
+    break;
+  }
+  case RuntimeOutputLine::SET_MODEL_EVIDENCE_COUNT_AND_SUCCESS_RATE: {
+    auto model = replicodeObjects_.getObject(id[0]);
+    if (model)
+      return make_unique<SetModelEvidenceCountAndSuccessRateEvent>(
+        timestamp, model, line.evidenceCount_, line.successRate_);
+    break;
+  }
+  case RuntimeOutputLine::SET_MODEL_STRENGTH: {
+    auto model = replicodeObjects_.getObject(id[0]);
+    if (model)
+      return make_unique<SetModelStrengthEvent>(
+        timestamp, model, line.strength_);
+    break;
+  }
+  case RuntimeOutputLine::PHASE_IN_MODEL: {
+    auto model = replicodeObjects_.getObject(id[0]);
+    if (model)
+      return make_unique<PhaseInModelEvent>(timestamp, model);
+    break;
+  }
+  case RuntimeOutputLine::PHASE_OUT_MODEL: {
+    auto model = replicodeObjects_.getObject(id[0]);
+    if (model)
+      return make_unique<PhaseOutModelEvent>(timestamp, model);
+    break;
+  }
+  case RuntimeOutputLine::DELETE_MODEL: {
+    auto model = replicodeObjects_.getObject(id[0]);
+    if (model)
+      return make_unique<DeleteModelEvent>(timestamp, model);
+    break;
+  }
+  case RuntimeOutputLine::NEW_COMPOSITE_STATE: {
+    auto compositeState = replicodeObjects_.getObject(id[0]);
+    if (compositeState)
+      return make_unique<NewCompositeStateEvent>(
+        timestamp, compositeState, id[1]);
+    break;
+  }
+  case RuntimeOutputLine::AUTOFOCUS_NEW_OBJECT: {
+    auto fromObject = replicodeObjects_.getObject(id[0]);
+    auto toObject = replicodeObjects_.getObject(id[1]);
+    // Skip auto-focus of the same fact (such as eject facts).
+    // But show auto-focus of the same anti-fact (such as prediction failure).
+    if (fromObject && toObject /*debug && !(fromObject == toObject && fromObject->code(0).asOpcode() == Opcodes::Fact) */)
+      return make_unique<AutoFocusNewObjectEvent>(
+        timestamp, fromObject, toObject, line.syncMode_);
+    break;
+  }
+  case RuntimeOutputLine::MODEL_IMDL_PREDICTION_REDUCTION: {
+    auto reduction = replicodeObjects_.getObject(id[0]);
+    if (reduction) {
+      auto factImdl = reduction->get_reference(MK_RDX_IHLP_REF);
+      auto model = factImdl->get_reference(0)->get_reference(0);
+      // The super goal is the first (only) item in the set of inputs.
+      auto cause = reduction->get_reference(
+        reduction->code(reduction->code(MK_RDX_INPUTS).asIndex() + 1).asIndex());
+      // The prediction is the first (only) item in the set of productions.
+      auto factPred = AeraEvent::getFirstProduction(reduction);
+
+      if (model && cause && factPred) {
+        if (((_Fact*)factPred)->get_pred()->is_simulation())
+          return make_unique<ModelSimulatedPredictionReduction>(
+            timestamp, model, factPred, cause, (Code*)NULL, false, false);
+        else
+          return make_unique<ModelImdlPredictionEvent>(
+            timestamp, factPred, model, cause);
       }
-
-      if (f_p_f_icst && gotAllInputs)
-        events_.push_back(make_shared<NewPredictedInstantiatedCompositeStateEvent>(
-          timestamp, f_p_f_icst, inputs));
-    }
-    else if (regex_search(lineAfterTimestamp, matches, predictionSuccessRegex)) {
-      auto factSuccessFactPred = replicodeObjects_.getObject(stoul(matches[2].str()));
-      if (factSuccessFactPred)
-        events_.push_back(make_shared<PredictionResultEvent>(
-          timestamp, factSuccessFactPred));
-    }
-    else if (regex_search(lineAfterTimestamp, matches, predictionFailureRegex)) {
-      auto antiFactSuccessFactPred = replicodeObjects_.getObject(stoul(matches[1].str()));
-      if (antiFactSuccessFactPred)
-        events_.push_back(make_shared<PredictionResultEvent>(
-          timestamp, antiFactSuccessFactPred));
-    }
-    else if (regex_search(lineAfterTimestamp, matches, topLevelGoalSuccessRegex)) {
-      auto factSuccessFactGoal = replicodeObjects_.getObject(stoul(matches[1].str()));
-    }
-    else if (regex_search(lineAfterTimestamp, matches, ioDeviceInjectRegex)) {
-      auto object = replicodeObjects_.getObject(stoul(matches[1].str()));
-      if (object)
-        events_.push_back(make_shared<IoDeviceInjectEvent>(
-          timestamp, object, getTimestamp(matches, 2)));
     }
-    else if (regex_search(lineAfterTimestamp, matches, ioDeviceEjectWithRdxRegex)) {
-      auto reduction = replicodeObjects_.getObjectByDetailOid(stoul(matches[1].str()));
-      auto object = replicodeObjects_.getObject(stoul(matches[2].str()));
-      if (object)
-        events_.push_back(make_shared<IoDeviceEjectEvent>(
-          timestamp, object, reduction));
-    }
-    else if (regex_search(lineAfterTimestamp, matches, ioDeviceEjectWithoutRdxRegex)) {
-      auto object = replicodeObjects_.getObject(stoul(matches[1].str()));
-      if (object)
-        events_.push_back(make_shared<IoDeviceEjectEvent>(
-          timestamp, object, (Code*)NULL));
-    }
-    else if (regex_search(lineAfterTimestamp, matches, driveInjectRegex)) {
-      auto object = replicodeObjects_.getObject(stoul(matches[1].str()));
-      if (object)
-        events_.push_back(make_shared<DriveInjectEvent>(
-          timestamp, object, getTimestamp(matches, 2)));
-    }
-    else if (regex_search(lineAfterTimestamp, matches, simulationCommitRegex)) {
-      auto factGoal = replicodeObjects_.getObjectByDetailOid(stoul(matches[2].str()));
-      auto factPredFactSuccess = replicodeObjects_.getObject(stoul(matches[1].str()));
-      if (factGoal && factPredFactSuccess)
-        events_.push_back(make_shared<SimulationCommitEvent>(
-          timestamp, factGoal, factPredFactSuccess));
+    break;
+  }
+  case RuntimeOutputLine::MODEL_SIMULATED_PREDICTION_FROM_GOAL_REQUIREMENT: {
+    auto model = replicodeObjects_.getObject(id[0]);
+    auto factPred = replicodeObjects_.getObject(id[2]);
+    auto input = replicodeObjects_.getObjectByDetailOid(id[1]);
+    auto goal_requirement = replicodeObjects_.getObject(id[3]);
+
+    if (model && factPred && input && goal_requirement)
+      return make_unique<ModelSimulatedPredictionReductionFromGoalRequirement>(
+        timestamp, model, factPred, input, goal_requirement);
+    break;
+  }
+  case RuntimeOutputLine::MODEL_PREDICTION_DISABLED_BY_STRONG_REQUIREMENT: {
+    auto model = replicodeObjects_.getObject(id[0]);
+    auto input = replicodeObjects_.getObjectByDetailOid(id[1]);
+    Code* goal_requirement = 0;
+    if (line.hasOptionalId_)
+      goal_requirement = replicodeObjects_.getObject(id[2]);
+    auto strong_requirement = replicodeObjects_.getObjectByDetailOid(id[3]);
+
+    if (model && input && strong_requirement)
+      return make_unique<ModelPredictionFromRequirementDisabledEvent>(
+        timestamp, model, input, goal_requirement, strong_requirement);
+    break;
+  }
+  case RuntimeOutputLine::MODEL_PREDICTION_REDUCTION: {
+    auto reduction = replicodeObjects_.getObject(id[0]);
+    if (reduction) {
+      // Check the type of prediction.
+      auto factPred = AeraEvent::getFirstProduction(reduction);
+      auto pred = factPred->get_reference(0);
+      auto factValue = pred->get_reference(0);
+      auto value = factValue->get_reference(0);
+      auto valueOpcode = value->code(0).asOpcode();
+
+      if (valueOpcode == Opcodes::MkVal)
+        // The caller sets imdlPredictionEventIndex_ after searching the previous events.
+        return make_unique<ModelMkValPredictionReduction>(timestamp, reduction, -1);
     }
-    else if (regex_search(lineAfterTimestamp, matches, simulationPromotedSimulatedPredictionRegex)) {
-      auto promotedFact = replicodeObjects_.getObject(stoul(matches[2].str()));
-      auto promotedFromFact = replicodeObjects_.getObject(stoul(matches[1].str()));
-      auto timingsFact = replicodeObjects_.getObject(stoul(matches[3].str()));
-      if (promotedFact && promotedFromFact && timingsFact)
-        events_.push_back(make_shared<PromotedSimulatedPredictionEvent>(
-          timestamp, promotedFact, promotedFromFact,timingsFact));
+    break;
+  }
+  case RuntimeOutputLine::MODEL_ABDUCTION_REDUCTION: {
+    auto reduction = replicodeObjects_.getObject(id[0]);
+    if (reduction) {
+      auto factImdl = reduction->get_reference(MK_RDX_IHLP_REF);
+      auto model = factImdl->get_reference(0)->get_reference(0);
+      // The goal is the first (only) item in the set of productions.
+      auto factGoal = AeraEvent::getFirstProduction(reduction);
+      // The super goal is the first item in the set of inputs.
+      auto factSuperGoal = reduction->get_reference(
+        reduction->code(reduction->code(MK_RDX_INPUTS).asIndex() + 1).asIndex());
+      return make_unique<ModelGoalReduction>(
+        timestamp, model, factGoal, factSuperGoal);
     }
-    else if (regex_search(lineAfterTimestamp, matches, simulationPromotedSimulatedPredictionDefeatedRegex)) {
-      auto input = replicodeObjects_.getObject(stoul(matches[2].str()));
-      auto promotedFact = replicodeObjects_.getObject(stoul(matches[1].str()));
-      if (input && promotedFact)
-        events_.push_back(make_shared<PromotedSimulatedPredictionDefeatEvent>(
-          timestamp, input, promotedFact));
+    break;
+  }
+  case RuntimeOutputLine::MODEL_SIMULATED_ABDUCTION: {
+    auto model = replicodeObjects_.getObject(id[0]);
+    auto factGoal = replicodeObjects_.getObject(id[2]);
+    auto factSuperGoal = replicodeObjects_.getObject(id[1]);
+    if (model && factGoal && factSuperGoal)
+      return make_unique<ModelGoalReduction>(
+        timestamp, model, factGoal, factSuperGoal);
+    break;
+  }
+  case RuntimeOutputLine::COMPOSITE_STATE_SIMULATED_ABDUCTION: {
+    auto compositeState = replicodeObjects_.getObject(id[0]);
+    auto factGoal = replicodeObjects_.getObject(id[2]);
+    auto factSuperGoal = replicodeObjects_.getObject(id[1]);
+    if (compositeState && factGoal && factSuperGoal)
+      return make_unique<CompositeStateGoalReduction>(
+        timestamp, compositeState, factGoal, factSuperGoal);
+    break;
+  }
+  case RuntimeOutputLine::MODEL_SIMULATED_PREDICTION: {
+    auto model = replicodeObjects_.getObject(id[0]);
+    auto input = replicodeObjects_.getObject(id[1]);
+    auto factPred = replicodeObjects_.getObject(id[2]);
+    bool factPredIsImdl = line.flag_;
+    Code* requirement = 0;
+    if (line.hasOptionalId_)
+      requirement = replicodeObjects_.getObjectByDetailOid(id[3]);
+
+    if (model && factPred && input)
+      return make_unique<ModelSimulatedPredictionReduction>(
+        timestamp, model, factPred, input, requirement, false, factPredIsImdl);
+    break;
+  }
+  case RuntimeOutputLine::MODEL_SIMULATED_PREDICTION_START: {
+    auto model = replicodeObjects_.getObject(id[0]);
+    auto input = replicodeObjects_.getObject(id[1]);
+    auto factPred = replicodeObjects_.getObjectByDetailOid(id[2]);
+    Code* requirement = 0;
+    if (line.hasOptionalId_)
+      requirement = replicodeObjects_.getObjectByDetailOid(id[3]);
+
+    if (model && factPred && input) {
+      core::Timestamp injectionTime = replicodeObjects_.getTimeReference() + line.injectionTime_;
+      if (injectionTime < timestamp)
+        // We don't expect this, but the runtime would not have injected earlier.
+        injectionTime = timestamp;
+      // TODO: Use an AeraEvent with the details of starting the simulated forward chaining, and include requirement.
+      // RuntimeOutputMerger holds this to be added to events_ later.
+      return make_unique<ModelSimulatedPredictionReduction>(injectionTime, model, factPred, input, requirement, true, false);
     }
+    break;
   }
-
-  // Transfer any remaining pendingEvents to events_.
-  for (auto event = pendingEvents.begin(); event != pendingEvents.end(); ++event) {
-    for (int i = 0; i < event->second.size(); ++i)
-      events_.push_back(event->second[i]);
+  case RuntimeOutputLine::COMPOSITE_STATE_SIMULATED_PREDICTION: {
+    auto compositeState = replicodeObjects_.getObject(id[0]);
+    auto factPred = replicodeObjects_.getObject(id[2]);
+    auto input = replicodeObjects_.getObject(id[1]);
+
+    // Get the matching inputs.
+    vector<Code*> inputs;
+    if (compositeState && factPred && input && getObjects(line.inputs_, inputs))
+      return make_unique<CompositeStateSimulatedPredictionReduction>(
+        timestamp, compositeState, factPred, input, inputs);
+    break;
+  }
+  case RuntimeOutputLine::NEW_INSTANTIATED_COMPOSITE_STATE: {
+    auto instantiatedCompositeState = replicodeObjects_.getObject(id[0]);
+
+    // Get the matching inputs.
+    vector<Code*> inputs;
+    if (instantiatedCompositeState && getObjects(line.inputs_, inputs))
+      return make_unique<NewInstantiatedCompositeStateEvent>(
+        timestamp, instantiatedCompositeState, inputs);
+    break;
+  }
+  case RuntimeOutputLine::NEW_PREDICTED_INSTANTIATED_COMPOSITE_STATE: {
+    auto f_p_f_icst = replicodeObjects_.getObject(id[0]);
+
+    // Get the matching inputs.
+    vector<Code*> inputs;
+    if (f_p_f_icst && getObjects(line.inputs_, inputs))
+      return make_unique<NewPredictedInstantiatedCompositeStateEvent>(
+        timestamp, f_p_f_icst, inputs);
+    break;
+  }
+  case RuntimeOutputLine::PREDICTION_SUCCESS: {
+    auto factSuccessFactPred = replicodeObjects_.getObject(id[1]);
+    if (factSuccessFactPred)
+      return make_unique<PredictionResultEvent>(
+        timestamp, factSuccessFactPred);
+    break;
+  }
+  case RuntimeOutputLine::PREDICTION_FAILURE: {
+    auto antiFactSuccessFactPred = replicodeObjects_.getObject(id[0]);
+    if (antiFactSuccessFactPred)
+      return make_unique<PredictionResultEvent>(
+        timestamp, antiFactSuccessFactPred);
+    break;
+  }
+  case RuntimeOutputLine::TOP_LEVEL_GOAL_SUCCESS:
+    // We don't add an event for the top-level goal success.
+    break;
+  case RuntimeOutputLine::IO_DEVICE_INJECT: {
+    auto object = replicodeObjects_.getObject(id[0]);
+    if (object)
+      return make_unique<IoDeviceInjectEvent>(
+        timestamp, object, replicodeObjects_.getTimeReference() + line.injectionTime_);
+    break;
+  }
+  case RuntimeOutputLine::IO_DEVICE_EJECT_WITH_RDX: {
+    auto reduction = replicodeObjects_.getObjectByDetailOid(id[0]);
+    auto object = replicodeObjects_.getObject(id[1]);
+    if (object)
+      return make_unique<IoDeviceEjectEvent>(
+        timestamp, object, reduction);
+    break;
+  }
+  case RuntimeOutputLine::IO_DEVICE_EJECT_WITHOUT_RDX: {
+    auto object = replicodeObjects_.getObject(id[0]);
+    if (object)
+      return make_unique<IoDeviceEjectEvent>(
+        timestamp, object, (Code*)NULL);
+    break;
+  }
+  case RuntimeOutputLine::DRIVE_INJECT: {
+    auto object = replicodeObjects_.getObject(id[0]);
+    if (object)
+      return make_unique<DriveInjectEvent>(
+        timestamp, object, replicodeObjects_.getTimeReference() + line.injectionTime_);
+    break;
+  }
+  case RuntimeOutputLine::SIMULATION_COMMIT: {
+    auto factGoal = replicodeObjects_.getObjectByDetailOid(id[1]);
+    auto factPredFactSuccess = replicodeObjects_.getObject(id[0]);
+    if (factGoal && factPredFactSuccess)
+      return make_unique<SimulationCommitEvent>(
+        timestamp, factGoal, factPredFactSuccess);
+    break;
+  }
+  case RuntimeOutputLine::PROMOTED_SIMULATED_PREDICTION: {
+    auto promotedFact = replicodeObjects_.getObject(id[1]);
+    auto promotedFromFact = replicodeObjects_.getObject(id[0]);
+    auto timingsFact = replicodeObjects_.getObject(id[2]);
+    if (promotedFact && promotedFromFact && timingsFact)
+      return make_unique<PromotedSimulatedPredictionEvent>(
+        timestamp, promotedFact, promotedFromFact,timingsFact);
+    break;
+  }
+  case RuntimeOutputLine::PROMOTED_SIMULATED_PREDICTION_DEFEATED: {
+    auto input = replicodeObjects_.getObject(id[1]);
+    auto promotedFact = replicodeObjects_.getObject(id[0]);
+    if (input && promotedFact)
+      return make_unique<PromotedSimulatedPredictionDefeatEvent>(
+        timestamp, input, promotedFact);
+    break;
+  }
+  default:
+    break;
   }
-  pendingEvents.clear();
 
-  return true;
+  return unique_ptr<AeraEvent>();
 }
 
 void AeraVisulizerWindow::addStartupItems()
@@ -670,23 +692,33 @@ void AeraVisulizerWindow::addStartupItems()
       // Finished scanning the initial events.
       return;
 
+    AeraGraphicsItem* newItem;
     if (event->eventType_ == NewModelEvent::EVENT_TYPE)
       // TODO: Add arrows.
-      modelsScene_->addAeraGraphicsItem(
-        new ModelItem((NewModelEvent*)event, replicodeObjects_, modelsScene_));
+      newItem = new ModelItem((NewModelEvent*)event, replicodeObjects_, modelsScene_);
     else if (event->eventType_ == NewCompositeStateEvent::EVENT_TYPE)
       // TODO: Add arrows.
-      modelsScene_->addAeraGraphicsItem(
-        new CompositeStateItem((NewCompositeStateEvent*)event, replicodeObjects_, modelsScene_));
+      newItem = new CompositeStateItem((NewCompositeStateEvent*)event, replicodeObjects_, modelsScene_);
+    else
+      continue;
+
+    // Startup items don't flash, and the flash timer only drains the countdown of items given
+    // to establishFlashTimer, so clear it.
+    newItem->borderFlashCountdown_ = 0;
+    modelsScene_->addAeraGraphicsItem(newItem);
   }
 }
 
-Timestamp AeraVisulizerWindow::getTimestamp(const smatch& matches, int index)
+bool AeraVisulizerWindow::getObjects(const vector<uint64>& oids, vector<Code*>& objects) const
 {
-  microseconds us(1000000 * stoll(matches[index].str()) +
-                     1000 * stoll(matches[index + 1].str()) +
-                            stoll(matches[index + 2].str()));
-  return replicodeObjects_.getTimeReference() + us;
+  for (size_t i = 0; i < oids.size(); ++i) {
+    auto object = replicodeObjects_.getObject(oids[i]);
+    if (!object)
+      return false;
+    objects.push_back(object);
+  }
+
+  return true;
 }
 
 AeraGraphicsItem* AeraVisulizerWindow::getAeraGraphicsItem(Code* object, AeraVisualizerScene** scene)
@@ -799,101 +831,63 @@ void AeraVisulizerWindow::textItemHoverMoveEvent(const QTextDocument* document,
 Timestamp AeraVisulizerWindow::getINextStepEvent
   (Timestamp maximumTime, size_t iNextEventStart, size_t& iNextStepEvent)
 {
-  // TODO: This has to closely track stepEvent to duplicate its logic, so stepEvent should be
-  // rewritten to provide the functionality to show what the next event would be without doing it.
   if (iNextEventStart >= events_.size())
     // Return the value meaning no change.
     return Utils_MaxTime;
 
-  AeraEvent* event = events_[iNextEventStart].get();
-  if (event->time_ > maximumTime)
+  // Jump over the events that stepEvent skips.
+  iNextStepEvent = iNextStepEvents_[iNextEventStart];
+  if (iNextStepEvent >= events_.size())
     return Utils_MaxTime;
 
-  // Default to the same initial event.
-  iNextStepEvent = iNextEventStart;
-
-  if (newItemEventTypes_.find(event->eventType_) != newItemEventTypes_.end()) {
-    if (event->eventType_ == AutoFocusNewObjectEvent::EVENT_TYPE) {
-      if (event->time_ == replicodeObjects_.getTimeReference())
-        // Debug: For now, skip auto focus events at startup.
-        return getINextStepEvent(maximumTime, iNextEventStart + 1, iNextStepEvent);
-    }
-  }
-  else if (event->eventType_ == SetModelEvidenceCountAndSuccessRateEvent::EVENT_TYPE ||
-           event->eventType_ == SetModelStrengthEvent::EVENT_TYPE ||
-           event->eventType_ == PhaseInModelEvent::EVENT_TYPE ||
-           event->eventType_ == PhaseOutModelEvent::EVENT_TYPE ||
-           event->eventType_ == DeleteModelEvent::EVENT_TYPE) {
-    // We already set the default iNextStepEvent.
-  }
-  else
-    // Skip this event.
-    return getINextStepEvent(maximumTime, iNextEventStart + 1, iNextStepEvent);
+  auto eventTime = events_.getTime(iNextStepEvent);
+  if (eventTime > maximumTime)
+    return Utils_MaxTime;
 
-  return event->time_;
+  return eventTime;
 }
 
-Timestamp AeraVisulizerWindow::stepEvent(Timestamp maximumTime)
+Timestamp AeraVisulizerWindow::stepEvent(Timestamp maximumTime, bool skipModelStateEvents)
 {
-  if (iNextEvent_ >= events_.size())
-    // Return the value meaning no change.
-    return Utils_MaxTime;
-
-  AeraEvent* event = events_[iNextEvent_].get();
-  if (event->time_ > maximumTime)
-    return Utils_MaxTime;
-
-#if 1
-  auto relativeTime = duration_cast<microseconds>(event->time_ - replicodeObjects_.getTimeReference());
-  auto frameStartTime = event->time_ - (relativeTime % replicodeObjects_.getSamplingPeriod());
-  bool isNewFrame = (iNextEvent_ <= 0 || frameStartTime > events_[iNextEvent_ - 1]->time_);
-  if (isNewFrame) {
-    auto thisFrameMaxTime = frameStartTime + replicodeObjects_.getSamplingPeriod() - microseconds(1);
-
-    // Set iCommand to the simulation event showing a ModelGoalReduction for a command (presumably the simulation's committed goal).
-    // TODO: What about multiple committed goals including for mandatory solutions?
-    int iCommand = -1;
-    for (size_t i = iNextEvent_; i < events_.size(); ++i) {
-      if (events_[i]->time_ > thisFrameMaxTime)
-        // We searched the frame but didn't find a command.
-        break;
-
-      if (events_[i]->eventType_ == ModelGoalReduction::EVENT_TYPE) {
-        auto value = ((ModelGoalReduction*)events_[i].get())->factGoal_->get_goal()->get_target()->get_reference(0);
-        if (value->code(0).asOpcode() == Opcodes::Cmd) {
-          iCommand = i;
-          break;
-        }
-      }
+  size_t iFirstEvent = iNextEvent_;
+  while (true) {
+    if (iNextEvent_ >= events_.size())
+      // Return the value meaning no change.
+      return Utils_MaxTime;
+
+    // Jump over the events that stepEvent skips.
+    size_t iStepEvent = iNextStepEvents_[iNextEvent_];
+    if (iStepEvent >= events_.size() || events_.getTime(iStepEvent) > maximumTime) {
+      // There is no event to perform. Still pass the skipped events up to maximumTime.
+      while (iNextEvent_ < iStepEvent && events_.getTime(iNextEvent_) <= maximumTime)
+        ++iNextEvent_;
+      return Utils_MaxTime;
     }
 
-    if (iCommand >= 0) {
-      // Start from the committed command and get the chain of inputs and set the simulation detail OIDs.
-      std::set<int> focusSimulationDetailOids;
-      int i = iCommand;
-      while (i >= iNextEvent_) {
-        focusSimulationDetailOids.insert(events_[i]->object_->get_detail_oid());
+    iNextEvent_ = iStepEvent;
+    if (skipModelStateEvents && stepKinds_[events_.getType(iNextEvent_)] == STEP_MODEL_STATE)
+      // The caller will call setModelStates.
+      ++iNextEvent_;
+    else
+      break;
+  }
 
-        auto input = events_[i]->getInput();
-        if (!input)
-          // The end of the backward links, presumably the drive.
-          break;
-
-        // Keep searching backwards (back to the first simulation event) for the event of the input.
-        --i;
-        for (; i >= iNextEvent_; --i) {
-          if (events_[i]->object_ == input)
-            break;
-        }
-      }
+  int eventType = events_.getType(iNextEvent_);
+  Timestamp eventTime = events_.getTime(iNextEvent_);
 
+#if 1
+  // Compare to the frame of the event before the skipped events, in case a skipped event started the frame.
+  bool isNewFrame = (iFirstEvent <= 0 || eventFrames_[iNextEvent_] != eventFrames_[iFirstEvent - 1]);
+  if (isNewFrame) {
+    const Frame& frame = getFrame(iNextEvent_);
+    if (frame.iCommand_ >= (int)iNextEvent_)
       // This will display the focus simulation items at the top.
-      mainScene_->setFocusSimulationDetailOids(focusSimulationDetailOids);
-    }
+      mainScene_->setFocusSimulationDetailOids(frame.focusSimulationDetailOids_);
   }
 #endif
 
-  if (newItemEventTypes_.find(event->eventType_) != newItemEventTypes_.end()) {
+  if (stepKinds_[eventType] == STEP_NEW_ITEM) {
+    AeraEvent* event = events_.get(iNextEvent_);
     AeraGraphicsItem* newItem;
     bool visible = true;
 
@@ -917,12 +911,8 @@ Timestamp AeraVisulizerWindow::stepEvent(Timestamp maximumTime)
     else if (event->eventType_ == NewCompositeStateEvent::EVENT_TYPE)
       newItem = new CompositeStateItem((NewCompositeStateEvent*)event, replicodeObjects_, scene);
     else if (event->eventType_ == AutoFocusNewObjectEvent::EVENT_TYPE) {
+      // iNextStepEvents_ skips auto focus events at startup.
       auto autoFocusEvent = (AutoFocusNewObjectEvent*)event;
-      if (event->time_ == replicodeObjects_.getTimeReference()) {
-        // Debug: For now, skip auto focus events at startup.
-        ++iNextEvent_;
-        return stepEvent(maximumTime);
-      }
 
       newItem = new AutoFocusFactItem(autoFocusEvent, replicodeObjects_, scene);
 
@@ -1227,102 +1217,105 @@ Timestamp AeraVisulizerWindow::stepEvent(Timestamp maximumTime)
 
     if (visible)
       // Only flash if visible.
-      scene->establishFlashTimer();
+      scene->establishFlashTimer(newItem);
+    else
+      // The flash timer only drains the countdown of items given to establishFlashTimer, so
+      // clear it. Otherwise the border would flash with a later value change of the item.
+      newItem->borderFlashCountdown_ = 0;
   }
-  else if (event->eventType_ == SetModelEvidenceCountAndSuccessRateEvent::EVENT_TYPE) {
-    auto setSuccessRateEvent = (SetModelEvidenceCountAndSuccessRateEvent*)event;
+  else if (eventType == SetModelEvidenceCountAndSuccessRateEvent::EVENT_TYPE) {
+    // The event values are in the events_ side table.
+    auto model = events_.getObject(iNextEvent_);
+    auto& values = events_.getEvidenceCountAndSuccessRate(iNextEvent_);
 
     // Save the current values for a later undo.
-    setSuccessRateEvent->oldEvidenceCount_ = setSuccessRateEvent->object_->code(MDL_CNT).asFloat();
-    setSuccessRateEvent->oldSuccessRate_ = setSuccessRateEvent->object_->code(MDL_SR).asFloat();
+    values.oldEvidenceCount_ = model->code(MDL_CNT).asFloat();
+    values.oldSuccessRate_ = model->code(MDL_SR).asFloat();
 
     // Update the model.
-    setSuccessRateEvent->object_->code(MDL_CNT) = Atom::Float(setSuccessRateEvent->evidenceCount_);
-    setSuccessRateEvent->object_->code(MDL_SR) = Atom::Float(setSuccessRateEvent->successRate_);
+    model->code(MDL_CNT) = Atom::Float(values.evidenceCount_);
+    model->code(MDL_SR) = Atom::Float(values.successRate_);
 
-    auto modelItem = dynamic_cast<ModelItem*>(modelsScene_->getAeraGraphicsItem(setSuccessRateEvent->object_));
+    auto modelItem = dynamic_cast<ModelItem*>(modelsScene_->getAeraGraphicsItem(model));
     if (modelItem) {
       modelItem->updateFromModel();
-      if (setSuccessRateEvent->evidenceCount_ != setSuccessRateEvent->oldEvidenceCount_ &&
-          setSuccessRateEvent->successRate_ == setSuccessRateEvent->oldSuccessRate_)
+      if (values.evidenceCount_ != values.oldEvidenceCount_ &&
+          values.successRate_ == values.oldSuccessRate_)
         // Only the evidence count changed.
         modelItem->evidenceCountFlashCountdown_ = AeraVisualizerScene::FLASH_COUNT;
-      else if (setSuccessRateEvent->evidenceCount_ == setSuccessRateEvent->oldEvidenceCount_ &&
-        setSuccessRateEvent->successRate_ != setSuccessRateEvent->oldSuccessRate_)
+      else if (values.evidenceCount_ == values.oldEvidenceCount_ &&
+        values.successRate_ != values.oldSuccessRate_)
         // Only the success rate changed.
         modelItem->successRateFlashCountdown_ = AeraVisualizerScene::FLASH_COUNT;
       else {
         modelItem->evidenceCountFlashCountdown_ = AeraVisualizerScene::FLASH_COUNT;
         modelItem->successRateFlashCountdown_ = AeraVisualizerScene::FLASH_COUNT;
       }
-      modelsScene_->establishFlashTimer();
+      modelsScene_->establishFlashTimer(modelItem);
     }
   }
-  else if (event->eventType_ == SetModelStrengthEvent::EVENT_TYPE) {
-    auto setStrengthEvent = (SetModelStrengthEvent*)event;
+  else if (eventType == SetModelStrengthEvent::EVENT_TYPE) {
+    auto model = events_.getObject(iNextEvent_);
+    auto& values = events_.getStrength(iNextEvent_);
 
     // Save the current values for a later undo.
-    setStrengthEvent->oldStrength_ = setStrengthEvent->object_->code(MDL_STRENGTH).asFloat();
+    values.oldStrength_ = model->code(MDL_STRENGTH).asFloat();
 
     // Update the model.
-    setStrengthEvent->object_->code(MDL_STRENGTH) = Atom::Float(setStrengthEvent->strength_);
+    model->code(MDL_STRENGTH) = Atom::Float(values.strength_);
 
-    auto modelItem = dynamic_cast<ModelItem*>(modelsScene_->getAeraGraphicsItem(setStrengthEvent->object_));
+    auto modelItem = dynamic_cast<ModelItem*>(modelsScene_->getAeraGraphicsItem(model));
     if (modelItem) {
       modelItem->updateFromModel();
       modelItem->strengthFlashCountdown_ = AeraVisualizerScene::FLASH_COUNT;
-      modelsScene_->establishFlashTimer();
+      modelsScene_->establishFlashTimer(modelItem);
     }
   }
-  else if (event->eventType_ == PhaseInModelEvent::EVENT_TYPE) {
-    auto phaseInModelEvent = (PhaseInModelEvent*)event;
-
-    auto modelItem = dynamic_cast<ModelItem*>(modelsScene_->getAeraGraphicsItem(phaseInModelEvent->object_));
+  else if (eventType == PhaseInModelEvent::EVENT_TYPE) {
+    auto modelItem = dynamic_cast<ModelItem*>(modelsScene_->getAeraGraphicsItem(events_.getObject(iNextEvent_)));
     if (modelItem)
       // Set the background color.
       modelItem->setBrush(Qt::white);
   }
-  else if (event->eventType_ == PhaseOutModelEvent::EVENT_TYPE) {
-    auto phaseOutModelEvent = (PhaseOutModelEvent*)event;
-
-    auto modelItem = dynamic_cast<ModelItem*>(modelsScene_->getAeraGraphicsItem(phaseOutModelEvent->object_));
+  else if (eventType == PhaseOutModelEvent::EVENT_TYPE) {
+    auto modelItem = dynamic_cast<ModelItem*>(modelsScene_->getAeraGraphicsItem(events_.getObject(iNextEvent_)));
     if (modelItem)
       // Set the background color.
       modelItem->setBrush(phasedOutModelColor_);
   }
-  else if (event->eventType_ == DeleteModelEvent::EVENT_TYPE) {
-    auto deleteModelEvent = (DeleteModelEvent*)event;
-
-    auto modelItem = dynamic_cast<ModelItem*>(modelsScene_->getAeraGraphicsItem(deleteModelEvent->object_));
+  else if (eventType == DeleteModelEvent::EVENT_TYPE) {
+    auto modelItem = dynamic_cast<ModelItem*>(modelsScene_->getAeraGraphicsItem(events_.getObject(iNextEvent_)));
     if (modelItem)
       // Set the background color.
       modelItem->setBrush(Qt::gray);
   }
-  else {
-    // Skip this event.
-    ++iNextEvent_;
-    return stepEvent(maximumTime);
-  }
 
   ++iNextEvent_;
 
-  return event->time_;
+  return eventTime;
 }
 
-Timestamp AeraVisulizerWindow::unstepEvent(Timestamp minimumTime)
+Timestamp AeraVisulizerWindow::unstepEvent(Timestamp minimumTime, bool skipModelStateEvents)
 {
-  if (iNextEvent_ == 0)
-    // Return the value meaning no change.
-    return Utils_MaxTime;
+  while (true) {
+    if (iNextEvent_ == 0)
+      // Return the value meaning no change.
+      return Utils_MaxTime;
 
-  if (events_[iNextEvent_ - 1]->time_ < minimumTime)
-    // Don't decrement iNextEvent_.
-    return Utils_MaxTime;
+    if (events_.getTime(iNextEvent_ - 1) < minimumTime)
+      // Don't decrement iNextEvent_.
+      return Utils_MaxTime;
 
-  --iNextEvent_;
+    --iNextEvent_;
+    int stepKind = stepKinds_[events_.getType(iNextEvent_)];
+    if (stepKind == STEP_NEW_ITEM || (stepKind == STEP_MODEL_STATE && !skipModelStateEvents))
+      break;
+    // Skip this event. (For STEP_MODEL_STATE, the caller will call setModelStates.)
+  }
 
-  AeraEvent* event = events_[iNextEvent_].get();
-  if (newItemEventTypes_.find(event->eventType_) != newItemEventTypes_.end()) {
+  int eventType = events_.getType(iNextEvent_);
+  if (stepKinds_[eventType] == STEP_NEW_ITEM) {
+    AeraEvent* event = events_.get(iNextEvent_);
     AeraVisualizerScene* scene;
     if (event->eventType_ == NewModelEvent::EVENT_TYPE ||
       event->eventType_ == NewCompositeStateEvent::EVENT_TYPE)
@@ -1333,27 +1326,25 @@ Timestamp AeraVisulizerWindow::unstepEvent(Timestamp minimumTime)
     // Find the AeraGraphicsItem for this event and remove it.
     // Note that the event saves the updated item position and will use it when recreating the item.
     auto aeraGraphicsItem = dynamic_cast<AeraGraphicsItem*>(scene->getAeraGraphicsItem(event->object_));
-    if (aeraGraphicsItem) {
-      aeraGraphicsItem->removeArrowsAndHorizontalLines();
-      scene->removeItem(aeraGraphicsItem);
-      delete aeraGraphicsItem;
-    }
+    if (aeraGraphicsItem)
+      scene->removeAeraGraphicsItem(aeraGraphicsItem);
   }
-  else if (event->eventType_ == SetModelEvidenceCountAndSuccessRateEvent::EVENT_TYPE) {
+  else if (eventType == SetModelEvidenceCountAndSuccessRateEvent::EVENT_TYPE) {
     // Find the ModelItem for this event and set to the old evidence count and success rate.
-    auto setSuccessRateEvent = (SetModelEvidenceCountAndSuccessRateEvent*)event;
+    auto model = events_.getObject(iNextEvent_);
+    auto& values = events_.getEvidenceCountAndSuccessRate(iNextEvent_);
 
-    setSuccessRateEvent->object_->code(MDL_CNT) = Atom::Float(setSuccessRateEvent->oldEvidenceCount_);
-    setSuccessRateEvent->object_->code(MDL_SR) = Atom::Float(setSuccessRateEvent->oldSuccessRate_);
+    model->code(MDL_CNT) = Atom::Float(values.oldEvidenceCount_);
+    model->code(MDL_SR) = Atom::Float(values.oldSuccessRate_);
 
-    auto modelItem = dynamic_cast<ModelItem*>(modelsScene_->getAeraGraphicsItem(setSuccessRateEvent->object_));
+    auto modelItem = dynamic_cast<ModelItem*>(modelsScene_->getAeraGraphicsItem(model));
     if (modelItem) {
-      if (setSuccessRateEvent->evidenceCount_ != setSuccessRateEvent->oldEvidenceCount_ &&
-          setSuccessRateEvent->successRate_ == setSuccessRateEvent->oldSuccessRate_)
+      if (values.evidenceCount_ != values.oldEvidenceCount_ &&
+          values.successRate_ == values.oldSuccessRate_)
         // Only the evidence count changed.
         modelItem->evidenceCountFlashCountdown_ = AeraVisualizerScene::FLASH_COUNT;
-      else if (setSuccessRateEvent->evidenceCount_ == setSuccessRateEvent->oldEvidenceCount_ &&
-               setSuccessRateEvent->successRate_ != setSuccessRateEvent->oldSuccessRate_)
+      else if (values.evidenceCount_ == values.oldEvidenceCount_ &&
+               values.successRate_ != values.oldSuccessRate_)
         // Only the success rate changed.
         modelItem->successRateFlashCountdown_ = AeraVisualizerScene::FLASH_COUNT;
       else {
@@ -1362,61 +1353,278 @@ Timestamp AeraVisulizerWindow::unstepEvent(Timestamp minimumTime)
       }
 
       modelItem->updateFromModel();
-      modelsScene_->establishFlashTimer();
+      modelsScene_->establishFlashTimer(modelItem);
     }
   }
-  else if (event->eventType_ == SetModelStrengthEvent::EVENT_TYPE) {
+  else if (eventType == SetModelStrengthEvent::EVENT_TYPE) {
     // Find the ModelItem for this event and set to the old strength.
-    auto setStrengthEvent = (SetModelStrengthEvent*)event;
-
-    setStrengthEvent->object_->code(MDL_STRENGTH) = Atom::Float(setStrengthEvent->oldStrength_);
+    auto model = events_.getObject(iNextEvent_);
+    model->code(MDL_STRENGTH) = Atom::Float(events_.getStrength(iNextEvent_).oldStrength_);
 
-    auto modelItem = dynamic_cast<ModelItem*>(modelsScene_->getAeraGraphicsItem(setStrengthEvent->object_));
+    auto modelItem = dynamic_cast<ModelItem*>(modelsScene_->getAeraGraphicsItem(model));
     if (modelItem) {
       modelItem->strengthFlashCountdown_ = AeraVisualizerScene::FLASH_COUNT;
 
       modelItem->updateFromModel();
-      modelsScene_->establishFlashTimer();
+      modelsScene_->establishFlashTimer(modelItem);
     }
   }
-  else if (event->eventType_ == PhaseInModelEvent::EVENT_TYPE) {
+  else if (eventType == PhaseInModelEvent::EVENT_TYPE) {
     // Find the ModelItem for this event and set its appearance to not phased out.
-    auto phaseInModelEvent = (PhaseInModelEvent*)event;
-
-    auto modelItem = dynamic_cast<ModelItem*>(modelsScene_->getAeraGraphicsItem(phaseInModelEvent->object_));
+    auto modelItem = dynamic_cast<ModelItem*>(modelsScene_->getAeraGraphicsItem(events_.getObject(iNextEvent_)));
     if (modelItem)
       // Set the background color. Assume the model was phased out before phase in.
       modelItem->setBrush(phasedOutModelColor_);
   }
-  else if (event->eventType_ == PhaseOutModelEvent::EVENT_TYPE) {
+  else if (eventType == PhaseOutModelEvent::EVENT_TYPE) {
     // Find the ModelItem for this event and set its appearance to not phased out.
-    auto phaseOutModelEvent = (PhaseOutModelEvent*)event;
-
-    auto modelItem = dynamic_cast<ModelItem*>(modelsScene_->getAeraGraphicsItem(phaseOutModelEvent->object_));
+    auto modelItem = dynamic_cast<ModelItem*>(modelsScene_->getAeraGraphicsItem(events_.getObject(iNextEvent_)));
     if (modelItem)
       // Set the background color.
       modelItem->setBrush(Qt::white);
   }
-  else if (event->eventType_ == DeleteModelEvent::EVENT_TYPE) {
+  else if (eventType == DeleteModelEvent::EVENT_TYPE) {
     // Find the ModelItem for this event and set its appearance to not deleted.
-    auto deleteModelEvent = (DeleteModelEvent*)event;
-
-    auto modelItem = dynamic_cast<ModelItem*>(modelsScene_->getAeraGraphicsItem(deleteModelEvent->object_));
+    auto modelItem = dynamic_cast<ModelItem*>(modelsScene_->getAeraGraphicsItem(events_.getObject(iNextEvent_)));
     if (modelItem)
       // Set the background color.
       modelItem->setBrush(Qt::white);
   }
-  else
-    // Skip this event.
-    return unstepEvent(minimumTime);
 
   if (iNextEvent_ > 0)
-    return events_[iNextEvent_ - 1]->time_;
+    return events_.getTime(iNextEvent_ - 1);
   else
     // The caller will use the time reference.
     return Timestamp(seconds(0));
 }
 
+void AeraVisulizerWindow::unstepEvents(size_t iTargetEvent, bool skipModelStateEvents)
+{
+  if (iTargetEvent >= iNextEvent_)
+    return;
+
+  // What to update in the ModelItem of each model changed by the undone events.
+  struct ModelUndo {
+    ModelUndo()
+    : phaseEventType_(-1), isStrengthChanged_(false), isEvidenceCountChanged_(false), isSuccessRateChanged_(false)
+    {}
+
+    // The type of the earliest undone phase in, phase out or delete event, or -1 if none.
+    int phaseEventType_;
+    bool isStrengthChanged_;
+    bool isEvidenceCountChanged_;
+    bool isSuccessRateChanged_;
+  };
+
+  unordered_set<AeraEvent*> mainSceneEvents;
+  unordered_set<AeraEvent*> modelsSceneEvents;
+  unordered_map<Code*, ModelUndo> modelUndos;
+  // Go backwards so that the old values of the earliest event are the ones which remain.
+  for (size_t i = iNextEvent_; i-- > iTargetEvent;) {
+    int eventType = events_.getType(i);
+    int stepKind = stepKinds_[eventType];
+    if (stepKind == STEP_NEW_ITEM) {
+      if (eventType == NewModelEvent::EVENT_TYPE ||
+          eventType == NewCompositeStateEvent::EVENT_TYPE)
+        modelsSceneEvents.insert(events_.get(i));
+      else
+        mainSceneEvents.insert(events_.get(i));
+    }
+    else if (stepKind == STEP_MODEL_STATE && !skipModelStateEvents) {
+      auto model = events_.getObject(i);
+      ModelUndo& modelUndo = modelUndos[model];
+      if (eventType == SetModelEvidenceCountAndSuccessRateEvent::EVENT_TYPE) {
+        auto& values = events_.getEvidenceCountAndSuccessRate(i);
+        model->code(MDL_CNT) = Atom::Float(values.oldEvidenceCount_);
+        model->code(MDL_SR) = Atom::Float(values.oldSuccessRate_);
+        if (values.evidenceCount_ != values.oldEvidenceCount_)
+          modelUndo.isEvidenceCountChanged_ = true;
+        if (values.successRate_ != values.oldSuccessRate_)
+          modelUndo.isSuccessRateChanged_ = true;
+      }
+      else if (eventType == SetModelStrengthEvent::EVENT_TYPE) {
+        model->code(MDL_STRENGTH) = Atom::Float(events_.getStrength(i).oldStrength_);
+        modelUndo.isStrengthChanged_ = true;
+      }
+      else
+        // A phase in, phase out or delete event.
+        modelUndo.phaseEventType_ = eventType;
+    }
+  }
+  iNextEvent_ = iTargetEvent;
+
+  mainScene_->removeAeraGraphicsItems(mainSceneEvents);
+  modelsScene_->removeAeraGraphicsItems(modelsSceneEvents);
+  if (modelUndos.empty())
+    return;
+
+  // Update each remaining ModelItem once.
+  for (auto modelUndo = modelUndos.begin(); modelUndo != modelUndos.end(); ++modelUndo) {
+    auto modelItem = dynamic_cast<ModelItem*>(modelsScene_->getAeraGraphicsItem(modelUndo->first));
+    if (!modelItem)
+      // The item was removed with its NewModelEvent.
+      continue;
+
+    if (modelUndo->second.isStrengthChanged_)
+      modelItem->strengthFlashCountdown_ = AeraVisualizerScene::FLASH_COUNT;
+    if (modelUndo->second.isEvidenceCountChanged_)
+      modelItem->evidenceCountFlashCountdown_ = AeraVisualizerScene::FLASH_COUNT;
+    if (modelUndo->second.isSuccessRateChanged_)
+      modelItem->successRateFlashCountdown_ = AeraVisualizerScene::FLASH_COUNT;
+    if (modelUndo->second.isStrengthChanged_ || modelUndo->second.isEvidenceCountChanged_ ||
+        modelUndo->second.isSuccessRateChanged_) {
+      modelItem->updateFromModel();
+      modelsScene_->establishFlashTimer(modelItem);
+    }
+
+    // Set the background color as it was before the earliest phase event, as in unstepEvent.
+    if (modelUndo->second.phaseEventType_ == PhaseInModelEvent::EVENT_TYPE)
+      modelItem->setBrush(phasedOutModelColor_);
+    else if (modelUndo->second.phaseEventType_ == PhaseOutModelEvent::EVENT_TYPE ||
+             modelUndo->second.phaseEventType_ == DeleteModelEvent::EVENT_TYPE)
+      modelItem->setBrush(Qt::white);
+  }
+}
+
+void AeraVisulizerWindow::beginSceneBatch()
+{
+  mainScene_->beginBatch();
+  modelsScene_->beginBatch();
+}
+
+void AeraVisulizerWindow::endSceneBatch()
+{
+  mainScene_->endBatch();
+  modelsScene_->endBatch();
+}
+
+void AeraVisulizerWindow::setModelStates()
+{
+  ModelStateKeyframes::ModelStates states;
+  modelStateKeyframes_.getModelStates(events_, iNextEvent_, states);
+
+  // states has every model which has a model state event, including the models whose first
+  // event is after iNextEvent_, so that their values and phase are restored after a backward seek.
+  for (auto state = states.begin(); state != states.end(); ++state) {
+    state->first->code(MDL_STRENGTH) = Atom::Float(state->second.strength_);
+    state->first->code(MDL_CNT) = Atom::Float(state->second.evidenceCount_);
+    state->first->code(MDL_SR) = Atom::Float(state->second.successRate_);
+
+    auto modelItem = dynamic_cast<ModelItem*>(modelsScene_->getAeraGraphicsItem(state->first));
+    if (!modelItem)
+      // The model's item has not been made yet.
+      continue;
+
+    modelItem->updateFromModel();
+    if (state->second.phase_ == ModelStateKeyframes::PHASE_PHASED_OUT)
+      modelItem->setBrush(phasedOutModelColor_);
+    else if (state->second.phase_ == ModelStateKeyframes::PHASE_DELETED)
+      modelItem->setBrush(Qt::gray);
+    else
+      modelItem->setBrush(Qt::white);
+  }
+}
+
+void AeraVisulizerWindow::indexEvents()
+{
+  // Make iNextStepEvents_ backwards, so each entry can use the next.
+  iNextStepEvents_.resize(events_.size());
+  size_t iNextStepEvent = events_.size();
+  for (size_t i = events_.size(); i-- > 0;) {
+    // Debug: For now, skip auto focus events at startup.
+    if (stepKinds_[events_.getType(i)] != STEP_SKIP &&
+        !(events_.getType(i) == AutoFocusNewObjectEvent::EVENT_TYPE &&
+          events_.getTime(i) == replicodeObjects_.getTimeReference()))
+      iNextStepEvent = i;
+    iNextStepEvents_[i] = iNextStepEvent;
+  }
+
+  // Make the frame table. A new frame starts when an event's time is in a later sampling period
+  // than the previous event.
+  frames_.clear();
+  eventFrames_.resize(events_.size());
+  auto timeReference = replicodeObjects_.getTimeReference();
+  auto samplingPeriod = replicodeObjects_.getSamplingPeriod();
+  for (size_t i = 0; i < events_.size(); ++i) {
+    auto relativeTime = duration_cast<microseconds>(events_.getTime(i) - timeReference);
+    auto frameStartTime = events_.getTime(i) - (relativeTime % samplingPeriod);
+    if (frames_.empty() || frameStartTime > frames_.back().startTime_) {
+      frames_.push_back(Frame());
+      frames_.back().startTime_ = frameStartTime;
+      frames_.back().iFirstEvent_ = i;
+      frames_.back().iCommand_ = -1;
+    }
+    frames_.back().iEndEvent_ = i + 1;
+    eventFrames_[i] = (uint32)(frames_.size() - 1);
+
+    // Set iCommand_ to the first simulation event showing a ModelGoalReduction for a command
+    // (presumably the simulation's committed goal).
+    // TODO: What about multiple committed goals including for mandatory solutions?
+    if (frames_.back().iCommand_ < 0 && events_.getType(i) == ModelGoalReduction::EVENT_TYPE) {
+      auto value = ((ModelGoalReduction*)events_.get(i))->factGoal_->get_goal()->get_target()->get_reference(0);
+      if (value->code(0).asOpcode() == Opcodes::Cmd)
+        frames_.back().iCommand_ = i;
+    }
+  }
+
+  // For each frame with a command, start from the committed command and get the chain of
+  // inputs for the focus simulation detail OIDs.
+  unordered_map<Code*, size_t> lastObjectEvent;
+  vector<size_t> previousObjectEvent;
+  for (size_t iFrame = 0; iFrame < frames_.size(); ++iFrame) {
+    Frame& frame = frames_[iFrame];
+    if (frame.iCommand_ < 0)
+      continue;
+
+    // Index the events in the frame up to the command by object. previousObjectEvent links to
+    // the previous event in the frame with the same object, or events_.size() if none.
+    size_t iFirst = frame.iFirstEvent_;
+    size_t iCommand = frame.iCommand_;
+    lastObjectEvent.clear();
+    previousObjectEvent.resize(iCommand - iFirst);
+    for (size_t i = iFirst; i < iCommand; ++i) {
+      auto inserted = lastObjectEvent.insert(make_pair(events_.getObject(i), i));
+      previousObjectEvent[i - iFirst] = (inserted.second ? events_.size() : inserted.first->second);
+      inserted.first->second = i;
+    }
+
+    size_t i = iCommand;
+    while (true) {
+      frame.focusSimulationDetailOids_.insert(events_.getObject(i)->get_detail_oid());
+
+      // A model value event has no AeraEvent, and no input.
+      auto event = events_.get(i);
+      auto input = (event ? event->getInput() : 0);
+      if (!input)
+        // The end of the backward links, presumably the drive.
+        break;
+
+      // Find the last event of the input before i, back to the start of the frame.
+      auto found = lastObjectEvent.find(input);
+      if (found == lastObjectEvent.end())
+        break;
+      size_t iInput = found->second;
+      while (iInput < events_.size() && iInput >= i)
+        iInput = previousObjectEvent[iInput - iFirst];
+      if (iInput >= events_.size())
+        break;
+      i = iInput;
+    }
+  }
+
+  buildModelStateKeyframes();
+}
+
+void AeraVisulizerWindow::buildModelStateKeyframes()
+{
+  QSettings settings;
+  // The default is a keyframe every 100 frames.
+  int keyframeInterval = settings.value(SettingsKeyKeyframeInterval, 100).toInt();
+  modelStateKeyframes_.build(
+    events_, replicodeObjects_.getTimeReference(), replicodeObjects_.getSamplingPeriod(),
+    max(keyframeInterval, 0));
+}
+
 void AeraVisulizerWindow::startPlay()
 {
   if (isPlaying_)
@@ -1427,6 +1635,8 @@ void AeraVisulizerWindow::startPlay()
   for (size_t i = 0; i < children_.size(); ++i)
     children_[i]->playPauseButton_->setIcon(pauseIcon_);
   isPlaying_ = true;
+  playClockStartTime_ = playTime_;
+  playClock_.start();
   if (playTimerId_ == 0)
     playTimerId_ = startTimer(AeraVisulizer_playTimerTick.count());
 }
@@ -1482,20 +1692,25 @@ void AeraVisulizerWindow::setPlayTime(Timestamp time)
 
 void AeraVisulizerWindow::setSliderToPlayTime()
 {
-  if (events_.size() == 0) {
-    playSlider_->setValue(0);
-    for (size_t i = 0; i < children_.size(); ++i)
-      children_[i]->playSlider_->setValue(0);
-    return;
+  int value = 0;
+  if (events_.size() > 0) {
+    auto maximumEventTime = events_.getTime(events_.size() - 1);
+    auto totalDuration = duration_cast<microseconds>(maximumEventTime - replicodeObjects_.getTimeReference()).count();
+    if (totalDuration > 0)
+      value = playSlider_->maximum() *
+        ((double)duration_cast<microseconds>(playTime_ - replicodeObjects_.getTimeReference()).count() /
+         totalDuration);
   }
 
-  auto maximumEventTime = events_.back()->time_;
-  int value = playSlider_->maximum() * 
-    ((double)duration_cast<microseconds>(playTime_ - replicodeObjects_.getTimeReference()).count() /
-     duration_cast<microseconds>(maximumEventTime - replicodeObjects_.getTimeReference()).count());
-  playSlider_->setValue(value);
-  for (size_t i = 0; i < children_.size(); ++i)
+  // Block signals so that setting the value doesn't call playSliderValueChanged to seek.
+  {
+    QSignalBlocker blocker(playSlider_);
+    playSlider_->setValue(value);
+  }
+  for (size_t i = 0; i < children_.size(); ++i) {
+    QSignalBlocker blocker(children_[i]->playSlider_);
     children_[i]->playSlider_->setValue(value);
+  }
 }
 
 void AeraVisulizerWindow::playPauseButtonClickedImpl()
@@ -1512,17 +1727,17 @@ void AeraVisulizerWindow::stepButtonClickedImpl()
   size_t iNextStepEvent;
   if (getINextStepEvent(Utils_MaxTime, iNextEvent_, iNextStepEvent) == Utils_MaxTime)
     return;
-  auto eventTime = events_[iNextStepEvent]->time_;
+  auto eventTime = events_.getTime(iNextStepEvent);
 
   // Keep stepping remaining events in this same frame.
-  auto relativeTime = duration_cast<microseconds>(eventTime - replicodeObjects_.getTimeReference());
-  auto frameStartTime = eventTime - (relativeTime % replicodeObjects_.getSamplingPeriod());
-  auto thisFrameMaxTime = frameStartTime + replicodeObjects_.getSamplingPeriod() - microseconds(1);
-  bool isNewFrame = (iNextStepEvent <= 0 || frameStartTime > events_[iNextStepEvent - 1]->time_);
+  const Frame& frame = getFrame(iNextStepEvent);
+  auto thisFrameMaxTime = frame.startTime_ + replicodeObjects_.getSamplingPeriod() - microseconds(1);
+  bool isNewFrame = (iNextStepEvent == frame.iFirstEvent_);
   auto firstEventTime = eventTime;
   bool firstEventIsSimulation = 
-    (simulationEventTypes_.find(events_[iNextStepEvent]->eventType_) != simulationEventTypes_.end());
+    (simulationEventTypes_.find(events_.getType(iNextStepEvent)) != simulationEventTypes_.end());
 
+  beginSceneBatch();
   int iNonSimulation = -1;
   if (isNewFrame) {
     // Remove the simulation items from the previous frame.
@@ -1533,9 +1748,9 @@ void AeraVisulizerWindow::stepButtonClickedImpl()
   else {
     if (firstEventIsSimulation) {
       // Not a new frame and the first event is a simulation, so we want to step all the simulations at once.
-      // Set iNonSimulation to the next non-simulation event.
-      for (iNonSimulation = iNextStepEvent; iNonSimulation < events_.size(); ++iNonSimulation) {
-        if (simulationEventTypes_.find(events_[iNonSimulation]->eventType_) == simulationEventTypes_.end())
+      // Set iNonSimulation to the next non-simulation event in the frame.
+      for (iNonSimulation = iNextStepEvent; iNonSimulation < frame.iEndEvent_; ++iNonSimulation) {
+        if (simulationEventTypes_.find(events_.getType(iNonSimulation)) == simulationEventTypes_.end())
           break;
       }
     }
@@ -1544,14 +1759,14 @@ void AeraVisulizerWindow::stepButtonClickedImpl()
   while (true) {
     if (stepEvent(thisFrameMaxTime) == Utils_MaxTime)
       break;
-    eventTime = events_[iNextEvent_ - 1]->time_;
+    eventTime = events_.getTime(iNextEvent_ - 1);
 
     if (simulationsCheckBox_->isChecked()) {
       if (isNewFrame) {
         // In a new frame, advance until the next item would be a simulation item that is not at the first event time.
         if (iNextEvent_ < events_.size() &&
-            simulationEventTypes_.find(events_[iNextEvent_]->eventType_) != simulationEventTypes_.end() &&
-            events_[iNextEvent_]->time_ > firstEventTime)
+            simulationEventTypes_.find(events_.getType(iNextEvent_)) != simulationEventTypes_.end() &&
+            events_.getTime(iNextEvent_) > firstEventTime)
           break;
       }
       else {
@@ -1561,6 +1776,7 @@ void AeraVisulizerWindow::stepButtonClickedImpl()
       }
     }
   }
+  endSceneBatch();
 
   setPlayTime(eventTime);
   setSliderToPlayTime();
@@ -1569,22 +1785,68 @@ void AeraVisulizerWindow::stepButtonClickedImpl()
 void AeraVisulizerWindow::stepBackButtonClickedImpl()
 {
   stopPlay();
-  auto newTime = max(unstepEvent(Timestamp(seconds(0))), replicodeObjects_.getTimeReference());
-  if (newTime == Utils_MaxTime)
+
+  // Find the last event which unstepEvent would undo.
+  size_t iEvent = iNextEvent_;
+  while (iEvent > 0 && stepKinds_[events_.getType(iEvent - 1)] == STEP_SKIP)
+    --iEvent;
+  if (iEvent == 0)
     return;
+  --iEvent;
   // Debug: How to step the children also?
 
-  // Keep unstepping remaining events in this same frame.
-  auto relativeTime = duration_cast<microseconds>(newTime - replicodeObjects_.getTimeReference());
-  auto frameStartTime = newTime - (relativeTime % replicodeObjects_.getSamplingPeriod());
-  while (true) {
-    auto localNewTime = unstepEvent(frameStartTime);
-    if (localNewTime == Utils_MaxTime)
-      break;
-    newTime = localNewTime;
+  // Also undo the remaining events in the frame before it, back to the frame start.
+  if (iEvent > 0) {
+    auto frameStartTime = getFrame(iEvent - 1).startTime_;
+    while (iEvent > 0 && events_.getTime(iEvent - 1) >= frameStartTime)
+      --iEvent;
+  }
+
+  beginSceneBatch();
+  unstepEvents(iEvent);
+  endSceneBatch();
+
+  // Use the time of the event before the ones we unstepped.
+  auto timeReference = replicodeObjects_.getTimeReference();
+  setPlayTime(iNextEvent_ > 0 ? max(events_.getTime(iNextEvent_ - 1), timeReference) : timeReference);
+  setSliderToPlayTime();
+}
+
+void AeraVisulizerWindow::playSliderValueChangedImpl(int value)
+{
+  stopPlay();
+  if (events_.size() == 0)
+    return;
+
+  auto timeReference = replicodeObjects_.getTimeReference();
+  auto maximumEventTime = events_.getTime(events_.size() - 1);
+  auto targetTime = timeReference + microseconds((microseconds::rep)(
+    ((double)value / playSlider_->maximum()) *
+    duration_cast<microseconds>(maximumEventTime - timeReference).count()));
+  targetTime = max(targetTime, timeReference);
+  // This is where stepEvent(targetTime) would stop if stepping from the first event.
+  size_t iTargetEvent = events_.getIndexAfter(targetTime);
+
+  if (iTargetEvent != iNextEvent_) {
+    // Don't lay out or repaint the scenes until all the events are stepped or unstepped.
+    beginSceneBatch();
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+
+    // As with stepping into a new frame, remove the simulation items of the current frame.
+    mainScene_->removeAllItemsByEventType(simulationEventTypes_);
+    mainScene_->setFocusSimulationDetailOids(set<int>());
+
+    // Only make and remove the items here. setModelStates will set the models from the nearest keyframe.
+    unstepEvents(iTargetEvent, true);
+    // Events up to iTargetEvent have a time not greater than targetTime, so stepEvent won't go past it.
+    while (iNextEvent_ < iTargetEvent && stepEvent(targetTime, true) != Utils_MaxTime);
+    setModelStates();
+
+    QApplication::restoreOverrideCursor();
+    endSceneBatch();
   }
 
-  setPlayTime(max(newTime, replicodeObjects_.getTimeReference()));
+  setPlayTime(targetTime);
   setSliderToPlayTime();
 }
 
@@ -1594,26 +1856,64 @@ void AeraVisulizerWindow::playTimeLabelClickedImpl()
   setPlayTime(playTime_);
 }
 
-void AeraVisulizerWindow::timerEvent(QTimerEvent* event)
+void AeraVisulizerWindow::playSpeedComboBoxIndexChangedImpl(int index)
 {
-  // TODO: Make sure we don't re-enter.
+  // Keep the combo boxes of all windows the same.
+  {
+    QSignalBlocker blocker(playSpeedComboBox_);
+    playSpeedComboBox_->setCurrentIndex(index);
+  }
+  for (size_t i = 0; i < children_.size(); ++i) {
+    QSignalBlocker blocker(children_[i]->playSpeedComboBox_);
+    children_[i]->playSpeedComboBox_->setCurrentIndex(index);
+  }
+
+  QSettings settings;
+  settings.setValue(SettingsKeyPlaySpeed, playSpeedComboBox_->itemData(index).toDouble());
 
+  if (isPlaying_) {
+    // Restart the play clock so that the new speed applies from now.
+    playClockStartTime_ = playTime_;
+    playClock_.restart();
+  }
+}
+
+void AeraVisulizerWindow::timerEvent(QTimerEvent* event)
+{
   if (event->timerId() != playTimerId_)
     // This timer event is not for us.
     return;
 
+  if (isInPlayTimerEvent_)
+    // We are still stepping events from the previous tick.
+    return;
+
   if (events_.size() == 0) {
     stopPlay();
     return;
   }
 
-  auto maximumEventTime = events_.back()->time_;
-  // TODO: Make this track the passage of real clock time.
-  auto playTime = playTime_ + AeraVisulizer_playTimerTick;
+  isInPlayTimerEvent_ = true;
+  beginSceneBatch();
+  auto maximumEventTime = events_.getTime(events_.size() - 1);
+  auto playTime = playClockStartTime_ + microseconds((microseconds::rep)(
+    playClock_.nsecsElapsed() / 1000 * playSpeedComboBox_->currentData().toDouble()));
+
+  // If this tick covers more than one frame after the next event's frame, because of the play speed
+  // or because stepping fell behind, then only make and remove the items up to the previous frame and
+  // set the models from the keyframes. This skips flashing the model values of the intermediate frames.
+  auto samplingPeriod = replicodeObjects_.getSamplingPeriod();
+  auto relativeTime = duration_cast<microseconds>(playTime - replicodeObjects_.getTimeReference());
+  auto previousFrameStartTime = playTime - (relativeTime % samplingPeriod) - samplingPeriod;
+  if (iNextEvent_ < events_.size() && events_.getTime(iNextEvent_) < previousFrameStartTime) {
+    while (stepEvent(previousFrameStartTime - microseconds(1), true) != Utils_MaxTime);
+    setModelStates();
+  }
 
   // Step events while events_[iNextEvent_] is less than or equal to the playTime.
   // Debug: How to step the children also?
   while (stepEvent(playTime) != Utils_MaxTime);
+  endSceneBatch();
 
   if (iNextEvent_ >= events_.size()) {
     // We have played all events.
@@ -1623,6 +1923,7 @@ void AeraVisulizerWindow::timerEvent(QTimerEvent* event)
 
   setPlayTime(playTime);
   setSliderToPlayTime();
+  isInPlayTimerEvent_ = false;
 }
 
 void AeraVisulizerWindow::zoomIn()
@@ -1717,8 +2018,11 @@ void AeraVisulizerWindow::createToolbars()
   simulationsCheckBox_ = new AeraCheckbox("Simulations", SettingsKeySimulationsVisible, this, Qt::Checked);
   simulationsCheckBox_->setColor(QColor("#ffffdc"));
   connect(simulationsCheckBox_, &QCheckBox::stateChanged, [=](int state) {
+    // Repaint once for all the event types.
+    mainScene_->beginBatch();
     for (auto i = simulationEventTypes_.begin(); i != simulationEventTypes_.end(); ++i)
       mainScene_->setItemsVisible(*i, state == Qt::Checked);
+    mainScene_->endBatch();
     });
   toolbar->addWidget(simulationsCheckBox_);
 
@@ -1733,7 +2037,8 @@ void AeraVisulizerWindow::createToolbars()
     predictedInstantiatedCompositeStatesCheckBox_->setEnabled(state == Qt::Checked);
     requirementsCheckBox_->setEnabled(state == Qt::Checked);
 
-    // Do the opposite of simulationsCheckBox_ .
+    // Do the opposite of simulationsCheckBox_ . Repaint once for all the changes.
+    mainScene_->beginBatch();
     mainScene_->setNonItemsVisible(simulationEventTypes_, state == Qt::Checked);
     if (state == Qt::Checked) {
       // Make specific non-simulation items not visible, if needed.
@@ -1745,6 +2050,7 @@ void AeraVisulizerWindow::createToolbars()
       mainScene_->setItemsVisible(
         ModelImdlPredictionEvent::EVENT_TYPE, requirementsCheckBox_->checkState() == Qt::Checked);
     }
+    mainScene_->endBatch();
   });
   toolbar->addWidget(nonSimulationsCheckBox_);
 
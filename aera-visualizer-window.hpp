@@ -55,14 +55,20 @@
 #ifndef AERA_VISUALIZER_WINDOW_HPP
 #define AERA_VISUALIZER_WINDOW_HPP
 
-#include <regex>
 #include "graphics-items/aera-graphics-item.hpp"
 #include "aera-event.hpp"
+#include "runtime-output-parser.hpp"
+#include "runtime-output-merger.hpp"
+#include "event-store.hpp"
+#include "model-state-keyframes.hpp"
 #include "aera-visualizer-window-base.hpp"
 #include "aera-checkbox.h"
 
 #include <vector>
+#include <set>
+#include <unordered_map>
 #include <QIcon>
+#include <QElapsedTimer>
 
 class AeraVisualizerScene;
 
@@ -104,6 +110,20 @@ public:
    */
   bool addEvents(const std::string& runtimeOutputFilePath, QProgressDialog& progress);
 
+  /**
+   * Set the event cache file which addEvents() reads instead of parsing the runtime output, if it
+   * was written for the same input files. Otherwise addEvents() parses the runtime output and writes
+   * the cache file. Call this before addEvents(). If not called, addEvents() does not use a cache.
+   * \param eventCacheFilePath The path of the event cache file.
+   * \param otherInputFilePaths The paths of the files other than the runtime output whose
+   * changes invalidate the cache, such as the decompiled objects file.
+   */
+  void setEventCache(const std::string& eventCacheFilePath, const std::vector<std::string>& otherInputFilePaths)
+  {
+    eventCacheFilePath_ = eventCacheFilePath;
+    eventCacheInputFilePaths_ = otherInputFilePaths;
+  }
+
   /**
    * Add the startup items to modelsScene_ for the startupEvents_ added by addEvents().
    */
@@ -161,9 +181,24 @@ public:
   /**
    * Get the AeraEvent at index i in the events list.
    * \param i The index.
-   * \return A pointer to the AeraEvent.
+   * \return A pointer to the AeraEvent, or null for a model value event which only has columns
+   * in the EventStore.
+   */
+  const AeraEvent* getAeraEvent(size_t i) const { return events_.get(i); }
+
+  /**
+   * Get the index in the events list of the last ModelImdlPredictionEvent whose object_ is the
+   * requirement prediction.
+   * \param requirement The requirement fact pred. If null, return -1.
+   * \return The event index, or -1 if not found.
    */
-  const AeraEvent* getAeraEvent(size_t i) const { return events_[i].get(); }
+  int getImdlPredictionEventIndex(r_code::Code* requirement) const
+  {
+    if (!requirement)
+      return -1;
+    auto found = imdlPredictionEventIndexes_.find(requirement);
+    return (found != imdlPredictionEventIndexes_.end() ? (int)found->second : -1);
+  }
 
   static const std::set<int> simulationEventTypes_;
 
@@ -172,8 +207,7 @@ protected:
    * Set iNextStepEvent to the index in events_ of the next event that stepEvent will process.
    * \param maximumTime If the time of next event is greater than maximumTime, don't perform the
    * event, and return Utils_MaxTime.
-   * \param iNextEventStart The index of the first event to consider, usually iNextEvent_ (but used
-   * internally to recursively call this method.
+   * \param iNextEventStart The index of the first event to consider, usually iNextEvent_.
    * \param iNextStepEvent the index in events_ of the next event that stepEvent will process. In most
    * cases, this is iNextEventStart. However, if this method returns Utils_MaxTime, then stepEvent will
    * not process a next event and iNextStepEvent is undefined.
@@ -186,19 +220,50 @@ protected:
    * Perform the event at events_[iNextEvent_] and then increment iNextEvent_.
    * \param maximumTime If the time of next event is greater than maximumTime, don't perform the
    * event, and return Utils_MaxTime.
+   * \param skipModelStateEvents (optional) If true, skip the events which change a model's
+   * values or phase (but still make the item for a NewModelEvent). A seek uses this and then
+   * calls setModelStates. If omitted, false.
    * \return The time of the next event. If there is no next event, then
    * return Utils_MaxTime.
    */
-  core::Timestamp stepEvent(core::Timestamp maximumTime);
+  core::Timestamp stepEvent(core::Timestamp maximumTime, bool skipModelStateEvents = false);
 
   /**
    * Decrement iNextEvent_ and undo the event at events_[iNextEvent_].
    * \param minimumTime if the time of previous event is less than minimumTime, don't
    * decrement iNextEvent_ and don't undo, and return Utils_MaxTime.
+   * \param skipModelStateEvents (optional) If true, skip the events which change a model's
+   * values or phase, as in stepEvent. If omitted, false.
    * \return The time of the previous event. If there is no previous event, then
    * return Utils_MaxTime.
    */
-  core::Timestamp unstepEvent(core::Timestamp minimumTime);
+  core::Timestamp unstepEvent(core::Timestamp minimumTime, bool skipModelStateEvents = false);
+
+  /**
+   * Undo all the events from iTargetEvent up to iNextEvent_ at once and set iNextEvent_ to
+   * iTargetEvent. This removes the items of the events from each scene in one pass, restores the
+   * model values from the old values in the events, then updates each changed ModelItem once.
+   * \param iTargetEvent The index of the first event to undo. If not less than iNextEvent_, do nothing.
+   * \param skipModelStateEvents (optional) If true, don't undo the events which change a model's
+   * values or phase, as in unstepEvent. If omitted, false.
+   */
+  void unstepEvents(size_t iTargetEvent, bool skipModelStateEvents = false);
+
+  /**
+   * Call beginBatch on the scenes, before stepping or unstepping several events.
+   */
+  void beginSceneBatch();
+
+  /**
+   * Call endBatch on the scenes, to lay out and repaint once after beginSceneBatch.
+   */
+  void endSceneBatch();
+
+  /**
+   * Use modelStateKeyframes_ to get the model states for iNextEvent_, and set the values of
+   * each model object and the appearance of its ModelItem.
+   */
+  void setModelStates();
 
   ExplanationLogWindow* explanationLogWindow_;
 
@@ -215,17 +280,27 @@ private:
   void createToolbars();
 
   /**
-   * Get the time stamp from the decimal strings of seconds, milliseconds and
-   * microseconds at matches[index], matches[index + 1] and matches[index + 2], then add
-   * replicodeObjects_.getTimeReference().
-   * \param matches The smatch object.
-   * \param index (optional) The matches index for the first number. If omitted, use 1.
-   * \return The timestamp.
+   * Make the AeraEvent for the parsed line of the runtime output.
+   * For MODEL_SIMULATED_PREDICTION_START, the event time is the injection time and
+   * RuntimeOutputMerger holds the event until then. For ModelMkValPredictionReduction, the
+   * caller should set imdlPredictionEventIndex_.
+   * \param line The parsed line.
+   * \return The new event, or null if the line has no event or an object is not found.
    */
-  core::Timestamp getTimestamp(const std::smatch& matches, int index = 1);
+  std::unique_ptr<AeraEvent> newAeraEvent(const RuntimeOutputLine& line) const;
 
   /**
-   * Enable the play timer to play events and set the playPauseButton_ icon.
+   * Get the object for each OID in oids and append to objects.
+   * \param oids The list of OIDs.
+   * \param objects Append the object for each OID to this list.
+   * \return True for success, or false if an object is not found, in which case
+   * objects has only the objects up to the first OID not found.
+   */
+  bool getObjects(const std::vector<uint64>& oids, std::vector<r_code::Code*>& objects) const;
+
+  /**
+   * Enable the play timer to play events and set the playPauseButton_ icon. Start the play
+   * clock so that the play time advances with real time, multiplied by the play speed.
    * If isPlaying_ is already true, do nothing.
    */
   void startPlay();
@@ -245,10 +320,38 @@ private:
    */
   void setSliderToPlayTime();
 
+  /**
+   * Make the indexes of events_ which are used for stepping, after all events are added.
+   */
+  void indexEvents();
+
+  /**
+   * Build modelStateKeyframes_ from events_, using the keyframe interval in the settings.
+   */
+  void buildModelStateKeyframes();
+
+  /**
+   * Make the table for stepKinds_ from newItemEventTypes_ and the model state event types.
+   */
+  static std::vector<uint8> makeStepKinds();
+
   void playPauseButtonClickedImpl();
   void stepButtonClickedImpl();
   void stepBackButtonClickedImpl();
+  /**
+   * Stop playing and seek to the play time for the slider value. Use the binary search of
+   * EventStore::getIndexAfter to find the target event index, then step or unstep to it in
+   * one pass with the scene views not repainting until the end.
+   * \param value The playSlider_ value.
+   */
+  void playSliderValueChangedImpl(int value);
   void playTimeLabelClickedImpl();
+  /**
+   * Set the play speed combo box of all windows to the index, save the play speed in the
+   * settings, and if playing then continue at the new speed from the current play time.
+   * \param index The index in playSpeedComboBox_.
+   */
+  void playSpeedComboBoxIndexChangedImpl(int index);
   void timerEvent(QTimerEvent* event) override;
 
   AeraVisualizerScene* modelsScene_;
@@ -268,6 +371,7 @@ private:
   static const QString SettingsKeyInstantiatedCompositeStatesVisible;
   static const QString SettingsKeyPredictedInstantiatedCompositeStatesVisible;
   static const QString SettingsKeyRequirementsVisible;
+  static const QString SettingsKeyKeyframeInterval;
 
   AeraCheckbox* simulationsCheckBox_;
   AeraCheckbox* nonSimulationsCheckBox_;
@@ -276,8 +380,13 @@ private:
   AeraCheckbox* predictedInstantiatedCompositeStatesCheckBox_;
   AeraCheckbox* requirementsCheckBox_;
 
-  std::vector<std::shared_ptr<AeraEvent> > startupEvents_;
-  std::vector<std::shared_ptr<AeraEvent> > events_;
+  std::vector<std::unique_ptr<AeraEvent> > startupEvents_;
+  EventStore events_;
+  ModelStateKeyframes modelStateKeyframes_;
+  // The key is the object_ of a ModelImdlPredictionEvent. The value is the index of its last event.
+  std::unordered_map<r_code::Code*, size_t> imdlPredictionEventIndexes_;
+  std::string eventCacheFilePath_;
+  std::vector<std::string> eventCacheInputFilePaths_;
   size_t iNextEvent_;
   QPen itemBorderHighlightPen_;
   AeraGraphicsItem* hoverHighlightItem_;
@@ -290,8 +399,48 @@ private:
   core::Timestamp playTime_;
   int playTimerId_;
   bool isPlaying_;
+  // While playing, the play time is playClockStartTime_ plus the real time elapsed in
+  // playClock_, multiplied by the play speed.
+  QElapsedTimer playClock_;
+  core::Timestamp playClockStartTime_;
+  bool isInPlayTimerEvent_;
   // The AeraEvent types where stepEvent will create a new AeraGraphicsItem.
   static const std::set<int> newItemEventTypes_;
+  // What stepEvent and unstepEvent do for an event, indexed by the AeraEvent eventType_.
+  enum StepKind {
+    STEP_SKIP,
+    STEP_NEW_ITEM,
+    STEP_MODEL_STATE
+  };
+  static const std::vector<uint8> stepKinds_;
+  // iNextStepEvents_[i] is the index of the first event at or after i which stepEvent performs,
+  // or events_.size() if none.
+  std::vector<size_t> iNextStepEvents_;
+
+  /**
+   * A Frame has the range of events_ in one sampling period, made by indexEvents.
+   */
+  struct Frame {
+    core::Timestamp startTime_;
+    size_t iFirstEvent_;
+    // One past the index of the last event in the frame.
+    size_t iEndEvent_;
+    // The index of the ModelGoalReduction for a command, or -1 if none.
+    int iCommand_;
+    // The detail OIDs of the chain of simulation events leading to the command.
+    std::set<int> focusSimulationDetailOids_;
+  };
+
+  /**
+   * Get the frame of the event.
+   * \param iEvent The index in events_ of the event.
+   * \return The Frame.
+   */
+  const Frame& getFrame(size_t iEvent) const { return frames_[eventFrames_[iEvent]]; }
+
+  std::vector<Frame> frames_;
+  // eventFrames_[i] is the index in frames_ of the frame of events_[i].
+  std::vector<uint32> eventFrames_;
 };
 
 }
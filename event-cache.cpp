@@ -0,0 +1,596 @@
+//_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/
+//_/_/
+//_/_/ AERA Visualizer
+//_/_/ 
+//_/_/ Copyright (c) 2018-2022 Jeff Thompson
+//_/_/ Copyright (c) 2018-2022 Kristinn R. Thorisson
+//_/_/ Copyright (c) 2018-2022 Icelandic Institute for Intelligent Machines
+//_/_/ http://www.iiim.is
+//_/_/
+//_/_/ --- Open-Source BSD License, with CADIA Clause v 1.0 ---
+//_/_/
+//_/_/ Redistribution and use in source and binary forms, with or without
+//_/_/ modification, is permitted provided that the following conditions
+//_/_/ are met:
+//_/_/ - Redistributions of source code must retain the above copyright
+//_/_/   and collaboration notice, this list of conditions and the
+//_/_/   following disclaimer.
+//_/_/ - Redistributions in binary form must reproduce the above copyright
+//_/_/   notice, this list of conditions and the following disclaimer 
+//_/_/   in the documentation and/or other materials provided with 
+//_/_/   the distribution.
+//_/_/
+//_/_/ - Neither the name of its copyright holders nor the names of its
+//_/_/   contributors may be used to endorse or promote products
+//_/_/   derived from this software without specific prior 
+//_/_/   written permission.
+//_/_/   
+//_/_/ - CADIA Clause: The license granted in and to the software 
+//_/_/   under this agreement is a limited-use license. 
+//_/_/   The software may not be used in furtherance of:
+//_/_/    (i)   intentionally causing bodily injury or severe emotional 
+//_/_/          distress to any person;
+//_/_/    (ii)  invading the personal privacy or violating the human 
+//_/_/          rights of any person; or
+//_/_/    (iii) committing or preparing for any act of war.
+//_/_/
+//_/_/ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND 
+//_/_/ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+//_/_/ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF 
+//_/_/ MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+//_/_/ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR 
+//_/_/ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+//_/_/ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, 
+//_/_/ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+//_/_/ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+//_/_/ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+//_/_/ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+//_/_/ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+//_/_/ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY 
+//_/_/ OF SUCH DAMAGE.
+//_/_/ 
+//_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/
+
+#include <QFile>
+#include <QSaveFile>
+#include <QDataStream>
+#include "submodules/AERA/r_exec/opcodes.h"
+#include "input-files-key.hpp"
+#include "event-cache.hpp"
+
+using namespace std;
+using namespace std::chrono;
+using namespace core;
+using namespace r_code;
+using namespace r_exec;
+
+namespace aera_visualizer {
+
+namespace {
+
+// The first value in the cache file.
+const quint32 CACHE_FILE_MAGIC = 0x41455643;
+// The detail OID stored for a null object.
+const quint64 NULL_DETAIL_OID = ~(quint64)0;
+
+void writeTime(QDataStream& stream, Timestamp time)
+{
+  stream << (qint64)duration_cast<microseconds>(time.time_since_epoch()).count();
+}
+
+Timestamp readTime(QDataStream& stream)
+{
+  qint64 us;
+  stream >> us;
+  return Timestamp(microseconds(us));
+}
+
+/**
+ * Write the object's detail OID.
+ * \return True for success, or false if the detail OID does not find the same object
+ * so that the object can't be stored.
+ */
+bool writeObject(QDataStream& stream, const ReplicodeObjects& replicodeObjects, Code* object)
+{
+  if (!object) {
+    stream << NULL_DETAIL_OID;
+    return true;
+  }
+
+  if (replicodeObjects.getObjectByDetailOid(object->get_detail_oid()) != object)
+    return false;
+  stream << (quint64)object->get_detail_oid();
+  return true;
+}
+
+bool writeObjects(QDataStream& stream, const ReplicodeObjects& replicodeObjects, const vector<Code*>& objects)
+{
+  stream << (quint32)objects.size();
+  for (size_t i = 0; i < objects.size(); ++i) {
+    if (!writeObject(stream, replicodeObjects, objects[i]))
+      return false;
+  }
+
+  return true;
+}
+
+/**
+ * Read a detail OID and get the object.
+ * \param ok If the detail OID is not null and the object is not found, set ok false.
+ * \return The object, or NULL if not found.
+ */
+Code* readObject(QDataStream& stream, const ReplicodeObjects& replicodeObjects, bool& ok)
+{
+  quint64 detailOid;
+  stream >> detailOid;
+  if (detailOid == NULL_DETAIL_OID)
+    return NULL;
+
+  auto object = replicodeObjects.getObjectByDetailOid(detailOid);
+  if (!object)
+    ok = false;
+  return object;
+}
+
+vector<Code*> readObjects(QDataStream& stream, const ReplicodeObjects& replicodeObjects, bool& ok)
+{
+  quint32 size;
+  stream >> size;
+  vector<Code*> objects;
+  for (quint32 i = 0; i < size && ok && stream.status() == QDataStream::Ok; ++i)
+    objects.push_back(readObject(stream, replicodeObjects, ok));
+
+  return objects;
+}
+
+}
+
+bool EventCache::read(
+  const string& cacheFilePath, const vector<string>& inputFilePaths,
+  const ReplicodeObjects& replicodeObjects, vector<unique_ptr<AeraEvent> >& startupEvents,
+  EventStore& events)
+{
+  QFile cacheFile(QString::fromStdString(cacheFilePath));
+  if (!cacheFile.open(QIODevice::ReadOnly) || cacheFile.size() == 0)
+    return false;
+  // Read through the QFile's buffer. Unlike a QByteArray, this has no 2 GB size limit.
+  QDataStream stream(&cacheFile);
+
+  quint32 magic, formatVersion;
+  stream >> magic >> formatVersion;
+  if (magic != CACHE_FILE_MAGIC || formatVersion != FORMAT_VERSION)
+    return false;
+  stream.setVersion(QDataStream::Qt_5_12);
+  stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+  // Check that the input files are the same as when the cache was written.
+  QByteArray key;
+  if (!getInputFilesKey(inputFilePaths, key))
+    return false;
+  QByteArray cacheKey;
+  stream >> cacheKey;
+  if (stream.status() != QDataStream::Ok || cacheKey != key)
+    return false;
+
+  vector<unique_ptr<AeraEvent> > newStartupEvents;
+  vector<unique_ptr<AeraEvent> > newEvents;
+  for (int iList = 0; iList < 2; ++iList) {
+    vector<unique_ptr<AeraEvent> >& newList = (iList == 0 ? newStartupEvents : newEvents);
+    quint64 size;
+    stream >> size;
+    if (stream.status() != QDataStream::Ok)
+      return false;
+
+    // Don't trust a size larger than the file. Each event has at least its type and time.
+    newList.reserve((size_t)min(size, (quint64)cacheFile.size() / (sizeof(qint32) + sizeof(qint64))));
+    for (quint64 i = 0; i < size; ++i) {
+      auto event = readEvent(stream, replicodeObjects);
+      if (!event)
+        return false;
+      newList.push_back(move(event));
+    }
+  }
+  if (stream.status() != QDataStream::Ok)
+    return false;
+
+  for (size_t i = 0; i < newStartupEvents.size(); ++i) {
+    if (newStartupEvents[i]->eventType_ == NewModelEvent::EVENT_TYPE) {
+      auto event = (NewModelEvent*)newStartupEvents[i].get();
+      // Restore the initial count, success rate and strength, as when parsing the load line.
+      event->object_->code(MDL_STRENGTH) = Atom::Float(event->strength_);
+      event->object_->code(MDL_CNT) = Atom::Float(event->evidenceCount_);
+      event->object_->code(MDL_SR) = Atom::Float(event->successRate_);
+    }
+  }
+
+  for (size_t i = 0; i < newStartupEvents.size(); ++i)
+    startupEvents.push_back(move(newStartupEvents[i]));
+  events.reserve(events.size() + newEvents.size());
+  for (size_t i = 0; i < newEvents.size(); ++i)
+    events.push_back(move(newEvents[i]));
+  return true;
+}
+
+bool EventCache::write(
+  const string& cacheFilePath, const vector<string>& inputFilePaths,
+  const ReplicodeObjects& replicodeObjects, const vector<unique_ptr<AeraEvent> >& startupEvents,
+  const EventStore& events)
+{
+  // Use QSaveFile so that there is no partial cache file if we don't finish.
+  QSaveFile cacheFile(QString::fromStdString(cacheFilePath));
+  if (!cacheFile.open(QIODevice::WriteOnly))
+    return false;
+  QDataStream stream(&cacheFile);
+
+  stream << CACHE_FILE_MAGIC << FORMAT_VERSION;
+  stream.setVersion(QDataStream::Qt_5_12);
+  stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+  QByteArray key;
+  if (!getInputFilesKey(inputFilePaths, key))
+    return false;
+  stream << key;
+
+  stream << (quint64)startupEvents.size();
+  for (size_t i = 0; i < startupEvents.size(); ++i) {
+    if (!writeEvent(stream, replicodeObjects, startupEvents[i].get())) {
+      cacheFile.cancelWriting();
+      return false;
+    }
+  }
+  stream << (quint64)events.size();
+  for (size_t i = 0; i < events.size(); ++i) {
+    // A model value event has no AeraEvent, so make one to write it the same way.
+    unique_ptr<AeraEvent> modelValueEvent = events.newModelValueEvent(i);
+    if (!writeEvent(stream, replicodeObjects, modelValueEvent ? modelValueEvent.get() : events.get(i))) {
+      cacheFile.cancelWriting();
+      return false;
+    }
+  }
+
+  if (stream.status() != QDataStream::Ok) {
+    cacheFile.cancelWriting();
+    return false;
+  }
+  return cacheFile.commit();
+}
+
+bool EventCache::writeEvent(QDataStream& stream, const ReplicodeObjects& replicodeObjects, AeraEvent* event)
+{
+  stream << (qint32)event->eventType_;
+  writeTime(stream, event->time_);
+
+  // Write the values for the event type's constructor.
+  switch (event->eventType_) {
+  case NewModelEvent::EVENT_TYPE: {
+    auto e = (NewModelEvent*)event;
+    stream << e->strength_ << e->evidenceCount_ << e->successRate_ << (quint64)e->controllerDegugOid_;
+    return writeObject(stream, replicodeObjects, e->object_);
+  }
+  case SetModelEvidenceCountAndSuccessRateEvent::EVENT_TYPE: {
+    auto e = (SetModelEvidenceCountAndSuccessRateEvent*)event;
+    stream << e->evidenceCount_ << e->successRate_;
+    return writeObject(stream, replicodeObjects, e->object_);
+  }
+  case SetModelStrengthEvent::EVENT_TYPE: {
+    auto e = (SetModelStrengthEvent*)event;
+    stream << e->strength_;
+    return writeObject(stream, replicodeObjects, e->object_);
+  }
+  case PhaseOutModelEvent::EVENT_TYPE:
+  case PhaseInModelEvent::EVENT_TYPE:
+  case DeleteModelEvent::EVENT_TYPE:
+  case PredictionResultEvent::EVENT_TYPE:
+    return writeObject(stream, replicodeObjects, event->object_);
+  case NewCompositeStateEvent::EVENT_TYPE:
+    stream << (quint64)((NewCompositeStateEvent*)event)->controllerDegugOid_;
+    return writeObject(stream, replicodeObjects, event->object_);
+  case AutoFocusNewObjectEvent::EVENT_TYPE: {
+    auto e = (AutoFocusNewObjectEvent*)event;
+    stream << QByteArray(e->syncMode_.c_str());
+    return writeObject(stream, replicodeObjects, e->fromObject_) &&
+           writeObject(stream, replicodeObjects, e->object_);
+  }
+  case ModelImdlPredictionEvent::EVENT_TYPE: {
+    auto e = (ModelImdlPredictionEvent*)event;
+    return writeObject(stream, replicodeObjects, e->object_) &&
+           writeObject(stream, replicodeObjects, e->predictingModel_) &&
+           writeObject(stream, replicodeObjects, e->cause_);
+  }
+  case ModelMkValPredictionReduction::EVENT_TYPE: {
+    auto e = (ModelMkValPredictionReduction*)event;
+    stream << (qint32)e->imdlPredictionEventIndex_;
+    return writeObject(stream, replicodeObjects, e->reduction_);
+  }
+  case ModelGoalReduction::EVENT_TYPE: {
+    auto e = (ModelGoalReduction*)event;
+    return writeObject(stream, replicodeObjects, e->model_) &&
+           writeObject(stream, replicodeObjects, e->factGoal_) &&
+           writeObject(stream, replicodeObjects, e->factSuperGoal_);
+  }
+  case CompositeStateGoalReduction::EVENT_TYPE: {
+    auto e = (CompositeStateGoalReduction*)event;
+    return writeObject(stream, replicodeObjects, e->compositeState_) &&
+           writeObject(stream, replicodeObjects, e->factGoal_) &&
+           writeObject(stream, replicodeObjects, e->factSuperGoal_);
+  }
+  case ModelSimulatedPredictionReduction::EVENT_TYPE: {
+    auto e = (ModelSimulatedPredictionReduction*)event;
+    stream << e->inputIsSuperGoal_ << e->factPredIsImdl_;
+    return writeObject(stream, replicodeObjects, e->model_) &&
+           writeObject(stream, replicodeObjects, e->factPred_) &&
+           writeObject(stream, replicodeObjects, e->input_) &&
+           writeObject(stream, replicodeObjects, e->requirement_);
+  }
+  case CompositeStateSimulatedPredictionReduction::EVENT_TYPE: {
+    auto e = (CompositeStateSimulatedPredictionReduction*)event;
+    return writeObject(stream, replicodeObjects, e->compositeState_) &&
+           writeObject(stream, replicodeObjects, e->factPred_) &&
+           writeObject(stream, replicodeObjects, e->input_) &&
+           writeObjects(stream, replicodeObjects, e->inputs_);
+  }
+  case NewInstantiatedCompositeStateEvent::EVENT_TYPE:
+    return writeObject(stream, replicodeObjects, event->object_) &&
+           writeObjects(stream, replicodeObjects, ((NewInstantiatedCompositeStateEvent*)event)->inputs_);
+  case NewPredictedInstantiatedCompositeStateEvent::EVENT_TYPE:
+    return writeObject(stream, replicodeObjects, event->object_) &&
+           writeObjects(stream, replicodeObjects, ((NewPredictedInstantiatedCompositeStateEvent*)event)->inputs_);
+  case IoDeviceInjectEvent::EVENT_TYPE:
+    writeTime(stream, ((IoDeviceInjectEvent*)event)->injectionTime_);
+    return writeObject(stream, replicodeObjects, event->object_);
+  case IoDeviceEjectEvent::EVENT_TYPE:
+    return writeObject(stream, replicodeObjects, event->object_) &&
+           writeObject(stream, replicodeObjects, ((IoDeviceEjectEvent*)event)->reduction_);
+  case DriveInjectEvent::EVENT_TYPE:
+    writeTime(stream, ((DriveInjectEvent*)event)->injectionTime_);
+    return writeObject(stream, replicodeObjects, event->object_);
+  case SimulationCommitEvent::EVENT_TYPE:
+    return writeObject(stream, replicodeObjects, event->object_) &&
+           writeObject(stream, replicodeObjects, ((SimulationCommitEvent*)event)->factPredFactSuccess_);
+  case ModelSimulatedPredictionReductionFromGoalRequirement::EVENT_TYPE: {
+    auto e = (ModelSimulatedPredictionReductionFromGoalRequirement*)event;
+    return writeObject(stream, replicodeObjects, e->model_) &&
+           writeObject(stream, replicodeObjects, e->factPred_) &&
+           writeObject(stream, replicodeObjects, e->input_) &&
+           writeObject(stream, replicodeObjects, e->goal_requirement_);
+  }
+  case ModelPredictionFromRequirementDisabledEvent::EVENT_TYPE: {
+    auto e = (ModelPredictionFromRequirementDisabledEvent*)event;
+    return writeObject(stream, replicodeObjects, e->model_) &&
+           writeObject(stream, replicodeObjects, e->input_) &&
+           writeObject(stream, replicodeObjects, e->goal_requirement_) &&
+           writeObject(stream, replicodeObjects, e->strong_requirement_);
+  }
+  case PromotedSimulatedPredictionEvent::EVENT_TYPE: {
+    auto e = (PromotedSimulatedPredictionEvent*)event;
+    return writeObject(stream, replicodeObjects, e->object_) &&
+           writeObject(stream, replicodeObjects, e->promotedFromFact_) &&
+           writeObject(stream, replicodeObjects, e->timingsFact_);
+  }
+  case PromotedSimulatedPredictionDefeatEvent::EVENT_TYPE: {
+    auto e = (PromotedSimulatedPredictionDefeatEvent*)event;
+    return writeObject(stream, replicodeObjects, e->input_) &&
+           writeObject(stream, replicodeObjects, e->promotedFact_);
+  }
+  default:
+    // We don't expect this. addEvents doesn't make other event types.
+    return false;
+  }
+}
+
+unique_ptr<AeraEvent> EventCache::readEvent(QDataStream& stream, const ReplicodeObjects& replicodeObjects)
+{
+  qint32 eventType;
+  stream >> eventType;
+  Timestamp time = readTime(stream);
+  if (stream.status() != QDataStream::Ok)
+    return unique_ptr<AeraEvent>();
+
+  bool ok = true;
+  unique_ptr<AeraEvent> event;
+  // Read the values in the same order as writeEvent.
+  switch (eventType) {
+  case NewModelEvent::EVENT_TYPE: {
+    core::float32 strength, evidenceCount, successRate;
+    quint64 controllerDegugOid;
+    stream >> strength >> evidenceCount >> successRate >> controllerDegugOid;
+    auto model = readObject(stream, replicodeObjects, ok);
+    if (model)
+      event = make_unique<NewModelEvent>(time, model, strength, evidenceCount, successRate, controllerDegugOid);
+    break;
+  }
+  case SetModelEvidenceCountAndSuccessRateEvent::EVENT_TYPE: {
+    core::float32 evidenceCount, successRate;
+    stream >> evidenceCount >> successRate;
+    auto model = readObject(stream, replicodeObjects, ok);
+    if (model)
+      event = make_unique<SetModelEvidenceCountAndSuccessRateEvent>(time, model, evidenceCount, successRate);
+    break;
+  }
+  case SetModelStrengthEvent::EVENT_TYPE: {
+    core::float32 strength;
+    stream >> strength;
+    auto model = readObject(stream, replicodeObjects, ok);
+    if (model)
+      event = make_unique<SetModelStrengthEvent>(time, model, strength);
+    break;
+  }
+  case PhaseOutModelEvent::EVENT_TYPE: {
+    auto model = readObject(stream, replicodeObjects, ok);
+    if (model)
+      event = make_unique<PhaseOutModelEvent>(time, model);
+    break;
+  }
+  case PhaseInModelEvent::EVENT_TYPE: {
+    auto model = readObject(stream, replicodeObjects, ok);
+    if (model)
+      event = make_unique<PhaseInModelEvent>(time, model);
+    break;
+  }
+  case DeleteModelEvent::EVENT_TYPE: {
+    auto model = readObject(stream, replicodeObjects, ok);
+    if (model)
+      event = make_unique<DeleteModelEvent>(time, model);
+    break;
+  }
+  case PredictionResultEvent::EVENT_TYPE: {
+    auto factSuccessFactPred = readObject(stream, replicodeObjects, ok);
+    if (factSuccessFactPred)
+      event = make_unique<PredictionResultEvent>(time, factSuccessFactPred);
+    break;
+  }
+  case NewCompositeStateEvent::EVENT_TYPE: {
+    quint64 controllerDegugOid;
+    stream >> controllerDegugOid;
+    auto compositeState = readObject(stream, replicodeObjects, ok);
+    if (compositeState)
+      event = make_unique<NewCompositeStateEvent>(time, compositeState, controllerDegugOid);
+    break;
+  }
+  case AutoFocusNewObjectEvent::EVENT_TYPE: {
+    QByteArray syncMode;
+    stream >> syncMode;
+    auto fromObject = readObject(stream, replicodeObjects, ok);
+    auto toObject = readObject(stream, replicodeObjects, ok);
+    if (fromObject && toObject)
+      event = make_unique<AutoFocusNewObjectEvent>(time, fromObject, toObject, syncMode.toStdString());
+    break;
+  }
+  case ModelImdlPredictionEvent::EVENT_TYPE: {
+    auto factPred = readObject(stream, replicodeObjects, ok);
+    auto predictingModel = readObject(stream, replicodeObjects, ok);
+    auto cause = readObject(stream, replicodeObjects, ok);
+    if (factPred)
+      event = make_unique<ModelImdlPredictionEvent>(time, factPred, predictingModel, cause);
+    break;
+  }
+  case ModelMkValPredictionReduction::EVENT_TYPE: {
+    qint32 imdlPredictionEventIndex;
+    stream >> imdlPredictionEventIndex;
+    auto reduction = readObject(stream, replicodeObjects, ok);
+    if (reduction)
+      event = make_unique<ModelMkValPredictionReduction>(time, reduction, imdlPredictionEventIndex);
+    break;
+  }
+  case ModelGoalReduction::EVENT_TYPE: {
+    auto model = readObject(stream, replicodeObjects, ok);
+    auto factGoal = readObject(stream, replicodeObjects, ok);
+    auto factSuperGoal = readObject(stream, replicodeObjects, ok);
+    if (factGoal)
+      event = make_unique<ModelGoalReduction>(time, model, factGoal, factSuperGoal);
+    break;
+  }
+  case CompositeStateGoalReduction::EVENT_TYPE: {
+    auto compositeState = readObject(stream, replicodeObjects, ok);
+    auto factGoal = readObject(stream, replicodeObjects, ok);
+    auto factSuperGoal = readObject(stream, replicodeObjects, ok);
+    if (factGoal)
+      event = make_unique<CompositeStateGoalReduction>(time, compositeState, factGoal, factSuperGoal);
+    break;
+  }
+  case ModelSimulatedPredictionReduction::EVENT_TYPE: {
+    bool inputIsSuperGoal, factPredIsImdl;
+    stream >> inputIsSuperGoal >> factPredIsImdl;
+    auto model = readObject(stream, replicodeObjects, ok);
+    auto factPred = readObject(stream, replicodeObjects, ok);
+    auto input = readObject(stream, replicodeObjects, ok);
+    auto requirement = readObject(stream, replicodeObjects, ok);
+    if (factPred)
+      event = make_unique<ModelSimulatedPredictionReduction>(
+        time, model, factPred, input, requirement, inputIsSuperGoal, factPredIsImdl);
+    break;
+  }
+  case CompositeStateSimulatedPredictionReduction::EVENT_TYPE: {
+    auto compositeState = readObject(stream, replicodeObjects, ok);
+    auto factPred = readObject(stream, replicodeObjects, ok);
+    auto input = readObject(stream, replicodeObjects, ok);
+    auto inputs = readObjects(stream, replicodeObjects, ok);
+    if (factPred)
+      event = make_unique<CompositeStateSimulatedPredictionReduction>(time, compositeState, factPred, input, inputs);
+    break;
+  }
+  case NewInstantiatedCompositeStateEvent::EVENT_TYPE: {
+    auto instantiatedCompositeState = readObject(stream, replicodeObjects, ok);
+    auto inputs = readObjects(stream, replicodeObjects, ok);
+    if (instantiatedCompositeState)
+      event = make_unique<NewInstantiatedCompositeStateEvent>(time, instantiatedCompositeState, inputs);
+    break;
+  }
+  case NewPredictedInstantiatedCompositeStateEvent::EVENT_TYPE: {
+    auto f_p_f_icst = readObject(stream, replicodeObjects, ok);
+    auto inputs = readObjects(stream, replicodeObjects, ok);
+    if (f_p_f_icst)
+      event = make_unique<NewPredictedInstantiatedCompositeStateEvent>(time, f_p_f_icst, inputs);
+    break;
+  }
+  case IoDeviceInjectEvent::EVENT_TYPE: {
+    Timestamp injectionTime = readTime(stream);
+    auto object = readObject(stream, replicodeObjects, ok);
+    if (object)
+      event = make_unique<IoDeviceInjectEvent>(time, object, injectionTime);
+    break;
+  }
+  case IoDeviceEjectEvent::EVENT_TYPE: {
+    auto object = readObject(stream, replicodeObjects, ok);
+    auto reduction = readObject(stream, replicodeObjects, ok);
+    if (object)
+      event = make_unique<IoDeviceEjectEvent>(time, object, reduction);
+    break;
+  }
+  case DriveInjectEvent::EVENT_TYPE: {
+    Timestamp injectionTime = readTime(stream);
+    auto object = readObject(stream, replicodeObjects, ok);
+    if (object)
+      event = make_unique<DriveInjectEvent>(time, object, injectionTime);
+    break;
+  }
+  case SimulationCommitEvent::EVENT_TYPE: {
+    auto factGoal = readObject(stream, replicodeObjects, ok);
+    auto factPredFactSuccess = readObject(stream, replicodeObjects, ok);
+    if (factGoal)
+      event = make_unique<SimulationCommitEvent>(time, factGoal, factPredFactSuccess);
+    break;
+  }
+  case ModelSimulatedPredictionReductionFromGoalRequirement::EVENT_TYPE: {
+    auto model = readObject(stream, replicodeObjects, ok);
+    auto factPred = readObject(stream, replicodeObjects, ok);
+    auto input = readObject(stream, replicodeObjects, ok);
+    auto goal_requirement = readObject(stream, replicodeObjects, ok);
+    if (factPred)
+      event = make_unique<ModelSimulatedPredictionReductionFromGoalRequirement>(
+        time, model, factPred, input, goal_requirement);
+    break;
+  }
+  case ModelPredictionFromRequirementDisabledEvent::EVENT_TYPE: {
+    auto model = readObject(stream, replicodeObjects, ok);
+    auto input = readObject(stream, replicodeObjects, ok);
+    auto goal_requirement = readObject(stream, replicodeObjects, ok);
+    auto strong_requirement = readObject(stream, replicodeObjects, ok);
+    event = make_unique<ModelPredictionFromRequirementDisabledEvent>(
+      time, model, input, goal_requirement, strong_requirement);
+    break;
+  }
+  case PromotedSimulatedPredictionEvent::EVENT_TYPE: {
+    auto promotedFact = readObject(stream, replicodeObjects, ok);
+    auto promotedFromFact = readObject(stream, replicodeObjects, ok);
+    auto timingsFact = readObject(stream, replicodeObjects, ok);
+    if (promotedFact)
+      event = make_unique<PromotedSimulatedPredictionEvent>(time, promotedFact, promotedFromFact, timingsFact);
+    break;
+  }
+  case PromotedSimulatedPredictionDefeatEvent::EVENT_TYPE: {
+    auto input = readObject(stream, replicodeObjects, ok);
+    auto promotedFact = readObject(stream, replicodeObjects, ok);
+    event = make_unique<PromotedSimulatedPredictionDefeatEvent>(time, input, promotedFact);
+    break;
+  }
+  default:
+    break;
+  }
+
+  if (!ok || stream.status() != QDataStream::Ok)
+    return unique_ptr<AeraEvent>();
+  return event;
+}
+
+}
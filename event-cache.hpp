@@ -0,0 +1,118 @@
+//_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/
+//_/_/
+//_/_/ AERA Visualizer
+//_/_/ 
+//_/_/ Copyright (c) 2018-2022 Jeff Thompson
+//_/_/ Copyright (c) 2018-2022 Kristinn R. Thorisson
+//_/_/ Copyright (c) 2018-2022 Icelandic Institute for Intelligent Machines
+//_/_/ http://www.iiim.is
+//_/_/
+//_/_/ --- Open-Source BSD License, with CADIA Clause v 1.0 ---
+//_/_/
+//_/_/ Redistribution and use in source and binary forms, with or without
+//_/_/ modification, is permitted provided that the following conditions
+//_/_/ are met:
+//_/_/ - Redistributions of source code must retain the above copyright
+//_/_/   and collaboration notice, this list of conditions and the
+//_/_/   following disclaimer.
+//_/_/ - Redistributions in binary form must reproduce the above copyright
+//_/_/   notice, this list of conditions and the following disclaimer 
+//_/_/   in the documentation and/or other materials provided with 
+//_/_/   the distribution.
+//_/_/
+//_/_/ - Neither the name of its copyright holders nor the names of its
+//_/_/   contributors may be used to endorse or promote products
+//_/_/   derived from this software without specific prior 
+//_/_/   written permission.
+//_/_/   
+//_/_/ - CADIA Clause: The license granted in and to the software 
+//_/_/   under this agreement is a limited-use license. 
+//_/_/   The software may not be used in furtherance of:
+//_/_/    (i)   intentionally causing bodily injury or severe emotional 
+//_/_/          distress to any person;
+//_/_/    (ii)  invading the personal privacy or violating the human 
+//_/_/          rights of any person; or
+//_/_/    (iii) committing or preparing for any act of war.
+//_/_/
+//_/_/ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND 
+//_/_/ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+//_/_/ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF 
+//_/_/ MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+//_/_/ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR 
+//_/_/ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+//_/_/ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, 
+//_/_/ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+//_/_/ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+//_/_/ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+//_/_/ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+//_/_/ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+//_/_/ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY 
+//_/_/ OF SUCH DAMAGE.
+//_/_/ 
+//_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/
+
+#ifndef EVENT_CACHE_HPP
+#define EVENT_CACHE_HPP
+
+#include <string>
+#include <vector>
+#include <memory>
+#include "aera-event.hpp"
+#include "event-store.hpp"
+#include "replicode-objects.hpp"
+
+class QDataStream;
+
+namespace aera_visualizer {
+
+/**
+ * EventCache has static methods to write the events parsed from the runtime output to a
+ * binary cache file, and to read them back on the next launch if the input files have not
+ * changed. An object is stored by its detail OID and is looked up again when reading.
+ */
+class EventCache {
+public:
+  /**
+   * Read the events from the cache file, if it was written by write() for the same input files.
+   * \param cacheFilePath The path of the cache file.
+   * \param inputFilePaths The paths of the files the events were made from, the same as given to write().
+   * \param replicodeObjects The ReplicodeObjects used to find objects.
+   * \param startupEvents Append the startup events to this list.
+   * \param events Append the events to this list.
+   * \return True for success, or false if the cache file does not exist, an input file has changed
+   * or an object is not found. If false, startupEvents and events are unchanged.
+   */
+  static bool read(
+    const std::string& cacheFilePath, const std::vector<std::string>& inputFilePaths,
+    const ReplicodeObjects& replicodeObjects, std::vector<std::unique_ptr<AeraEvent> >& startupEvents,
+    EventStore& events);
+
+  /**
+   * Write the events to the cache file along with the size, modification time and
+   * hash of each input file.
+   * \param cacheFilePath The path of the cache file.
+   * \param inputFilePaths The paths of the files the events were made from.
+   * \param replicodeObjects The ReplicodeObjects used to find objects.
+   * \param startupEvents The startup events.
+   * \param events The events.
+   * \return True for success, or false if the file can't be written or an event can't be
+   * stored, in which case there is no cache file.
+   */
+  static bool write(
+    const std::string& cacheFilePath, const std::vector<std::string>& inputFilePaths,
+    const ReplicodeObjects& replicodeObjects, const std::vector<std::unique_ptr<AeraEvent> >& startupEvents,
+    const EventStore& events);
+
+private:
+
+  static bool writeEvent(QDataStream& stream, const ReplicodeObjects& replicodeObjects, AeraEvent* event);
+
+  static std::unique_ptr<AeraEvent> readEvent(QDataStream& stream, const ReplicodeObjects& replicodeObjects);
+
+  // Increment this when changing the file format or an event type.
+  static const quint32 FORMAT_VERSION = 1;
+};
+
+}
+
+#endif
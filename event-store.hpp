@@ -0,0 +1,270 @@
+//_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/
+//_/_/
+//_/_/ AERA Visualizer
+//_/_/ 
+//_/_/ Copyright (c) 2018-2022 Jeff Thompson
+//_/_/ Copyright (c) 2018-2022 Kristinn R. Thorisson
+//_/_/ Copyright (c) 2018-2022 Icelandic Institute for Intelligent Machines
+//_/_/ http://www.iiim.is
+//_/_/
+//_/_/ --- Open-Source BSD License, with CADIA Clause v 1.0 ---
+//_/_/
+//_/_/ Redistribution and use in source and binary forms, with or without
+//_/_/ modification, is permitted provided that the following conditions
+//_/_/ are met:
+//_/_/ - Redistributions of source code must retain the above copyright
+//_/_/   and collaboration notice, this list of conditions and the
+//_/_/   following disclaimer.
+//_/_/ - Redistributions in binary form must reproduce the above copyright
+//_/_/   notice, this list of conditions and the following disclaimer 
+//_/_/   in the documentation and/or other materials provided with 
+//_/_/   the distribution.
+//_/_/
+//_/_/ - Neither the name of its copyright holders nor the names of its
+//_/_/   contributors may be used to endorse or promote products
+//_/_/   derived from this software without specific prior 
+//_/_/   written permission.
+//_/_/   
+//_/_/ - CADIA Clause: The license granted in and to the software 
+//_/_/   under this agreement is a limited-use license. 
+//_/_/   The software may not be used in furtherance of:
+//_/_/    (i)   intentionally causing bodily injury or severe emotional 
+//_/_/          distress to any person;
+//_/_/    (ii)  invading the personal privacy or violating the human 
+//_/_/          rights of any person; or
+//_/_/    (iii) committing or preparing for any act of war.
+//_/_/
+//_/_/ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND 
+//_/_/ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+//_/_/ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF 
+//_/_/ MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+//_/_/ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR 
+//_/_/ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+//_/_/ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, 
+//_/_/ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+//_/_/ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+//_/_/ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+//_/_/ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+//_/_/ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+//_/_/ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY 
+//_/_/ OF SUCH DAMAGE.
+//_/_/ 
+//_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/
+
+#ifndef EVENT_STORE_HPP
+#define EVENT_STORE_HPP
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include "aera-event.hpp"
+
+namespace aera_visualizer {
+
+/**
+ * An EventStore holds the list of events in columns. The time, event type and object of each
+ * event are in packed arrays so that a scan over many events, such as finding the end of a
+ * frame or the next event of a type, reads contiguous memory instead of following a pointer
+ * to each event. Most events of a long run only change the values or phase of a model. These
+ * never have an item, so their values are kept in a side table for the event type and the
+ * event has no AeraEvent. The other events keep their AeraEvent, which is needed to make the
+ * item and which the item points to.
+ */
+class EventStore {
+public:
+  /**
+   * The values of a SetModelEvidenceCountAndSuccessRateEvent, in a side table.
+   */
+  struct EvidenceCountAndSuccessRate {
+    core::float32 evidenceCount_;
+    core::float32 successRate_;
+    // The values before the event, for an undo.
+    core::float32 oldEvidenceCount_;
+    core::float32 oldSuccessRate_;
+  };
+
+  /**
+   * The values of a SetModelStrengthEvent, in a side table.
+   */
+  struct Strength {
+    core::float32 strength_;
+    // The value before the event, for an undo.
+    core::float32 oldStrength_;
+  };
+
+  /**
+   * Append the event. If it is a model value event, copy its values to the side table and
+   * delete it. Otherwise take ownership of it.
+   * \param event The event.
+   */
+  void push_back(std::unique_ptr<AeraEvent> event)
+  {
+    times_.push_back(event->time_);
+    maxTimes_.push_back(maxTimes_.empty() ? event->time_ : std::max(maxTimes_.back(), event->time_));
+    types_.push_back((uint8)event->eventType_);
+    objects_.push_back(event->object_);
+
+    if (event->eventType_ == SetModelEvidenceCountAndSuccessRateEvent::EVENT_TYPE) {
+      auto setSuccessRateEvent = (SetModelEvidenceCountAndSuccessRateEvent*)event.get();
+      rows_.push_back((uint32)evidenceCountAndSuccessRates_.size());
+      EvidenceCountAndSuccessRate row = {
+        setSuccessRateEvent->evidenceCount_, setSuccessRateEvent->successRate_,
+        setSuccessRateEvent->oldEvidenceCount_, setSuccessRateEvent->oldSuccessRate_ };
+      evidenceCountAndSuccessRates_.push_back(row);
+    }
+    else if (event->eventType_ == SetModelStrengthEvent::EVENT_TYPE) {
+      auto setStrengthEvent = (SetModelStrengthEvent*)event.get();
+      rows_.push_back((uint32)strengths_.size());
+      Strength row = { setStrengthEvent->strength_, setStrengthEvent->oldStrength_ };
+      strengths_.push_back(row);
+    }
+    else if (isModelValueEventType(event->eventType_))
+      // A phase in, phase out or delete event only has the columns.
+      rows_.push_back(0);
+    else {
+      rows_.push_back((uint32)events_.size());
+      events_.push_back(std::move(event));
+    }
+  }
+
+  void reserve(size_t size)
+  {
+    times_.reserve(size);
+    maxTimes_.reserve(size);
+    types_.reserve(size);
+    objects_.reserve(size);
+    rows_.reserve(size);
+  }
+
+  size_t size() const { return times_.size(); }
+
+  bool empty() const { return times_.empty(); }
+
+  /**
+   * Get the event with the values for its event type.
+   * \param i The index of the event.
+   * \return The event, or null if isModelValueEventType(getType(i)) because the event only
+   * has columns and a side table entry.
+   */
+  AeraEvent* get(size_t i) const
+  {
+    return isModelValueEventType(types_[i]) ? 0 : events_[rows_[i]].get();
+  }
+
+  core::Timestamp getTime(size_t i) const { return times_[i]; }
+
+  int getType(size_t i) const { return types_[i]; }
+
+  r_code::Code* getObject(size_t i) const { return objects_[i]; }
+
+  /**
+   * Get the values of the SetModelEvidenceCountAndSuccessRateEvent at index i.
+   * \param i The index of the event, whose type must be SetModelEvidenceCountAndSuccessRateEvent.
+   * \return The values, which can be changed to save the old values.
+   */
+  EvidenceCountAndSuccessRate& getEvidenceCountAndSuccessRate(size_t i)
+  {
+    return evidenceCountAndSuccessRates_[rows_[i]];
+  }
+
+  const EvidenceCountAndSuccessRate& getEvidenceCountAndSuccessRate(size_t i) const
+  {
+    return evidenceCountAndSuccessRates_[rows_[i]];
+  }
+
+  /**
+   * Get the values of the SetModelStrengthEvent at index i.
+   * \param i The index of the event, whose type must be SetModelStrengthEvent.
+   * \return The values, which can be changed to save the old value.
+   */
+  Strength& getStrength(size_t i) { return strengths_[rows_[i]]; }
+
+  const Strength& getStrength(size_t i) const { return strengths_[rows_[i]]; }
+
+  /**
+   * Make a new AeraEvent from the columns and side table of a model value event. This is for
+   * code such as the event cache which handles all events the same way. It allocates, so it
+   * should not be used in a scan over the events.
+   * \param i The index of the event.
+   * \return A new AeraEvent, or null if the event is not a model value event, in which case
+   * use get(i).
+   */
+  std::unique_ptr<AeraEvent> newModelValueEvent(size_t i) const
+  {
+    switch (types_[i]) {
+    case SetModelEvidenceCountAndSuccessRateEvent::EVENT_TYPE: {
+      auto& row = getEvidenceCountAndSuccessRate(i);
+      auto event = std::make_unique<SetModelEvidenceCountAndSuccessRateEvent>(
+        times_[i], objects_[i], row.evidenceCount_, row.successRate_);
+      event->oldEvidenceCount_ = row.oldEvidenceCount_;
+      event->oldSuccessRate_ = row.oldSuccessRate_;
+      return event;
+    }
+    case SetModelStrengthEvent::EVENT_TYPE: {
+      auto& row = getStrength(i);
+      auto event = std::make_unique<SetModelStrengthEvent>(times_[i], objects_[i], row.strength_);
+      event->oldStrength_ = row.oldStrength_;
+      return event;
+    }
+    case PhaseInModelEvent::EVENT_TYPE:
+      return std::make_unique<PhaseInModelEvent>(times_[i], objects_[i]);
+    case PhaseOutModelEvent::EVENT_TYPE:
+      return std::make_unique<PhaseOutModelEvent>(times_[i], objects_[i]);
+    case DeleteModelEvent::EVENT_TYPE:
+      return std::make_unique<DeleteModelEvent>(times_[i], objects_[i]);
+    default:
+      return std::unique_ptr<AeraEvent>();
+    }
+  }
+
+  /**
+   * Get the column of event times, in the order of the events.
+   */
+  const std::vector<core::Timestamp>& getTimes() const { return times_; }
+
+  /**
+   * Get the index of the first event whose time is greater than the given time. This is
+   * where stepping forward from the first event with stepEvent(time) stops, so a seek can
+   * jump there directly. This uses a binary search over the running maximum of the event
+   * times, so it is correct even if a few event times are out of order.
+   * \param time The time.
+   * \return The index of the first event with a greater time, or size() if none.
+   */
+  size_t getIndexAfter(core::Timestamp time) const
+  {
+    return std::upper_bound(maxTimes_.begin(), maxTimes_.end(), time) - maxTimes_.begin();
+  }
+
+  /**
+   * Check if the event type only changes the values or phase of a model, so that the event
+   * is stored in the columns and side tables without an AeraEvent.
+   * \param eventType The AeraEvent eventType_.
+   * \return True if it is a model value event type.
+   */
+  static bool isModelValueEventType(int eventType)
+  {
+    return eventType == SetModelEvidenceCountAndSuccessRateEvent::EVENT_TYPE ||
+      eventType == SetModelStrengthEvent::EVENT_TYPE ||
+      eventType == PhaseInModelEvent::EVENT_TYPE ||
+      eventType == PhaseOutModelEvent::EVENT_TYPE ||
+      eventType == DeleteModelEvent::EVENT_TYPE;
+  }
+
+private:
+  std::vector<core::Timestamp> times_;
+  // maxTimes_[i] is the maximum of times_[0] to times_[i], which is sorted for binary search.
+  std::vector<core::Timestamp> maxTimes_;
+  std::vector<uint8> types_;
+  std::vector<r_code::Code*> objects_;
+  // rows_[i] is the index of the event in the side table for its type: events_,
+  // evidenceCountAndSuccessRates_ or strengths_. Not used for phase and delete events.
+  std::vector<uint32> rows_;
+  // The events which are not model value events.
+  std::vector<std::unique_ptr<AeraEvent> > events_;
+  std::vector<EvidenceCountAndSuccessRate> evidenceCountAndSuccessRates_;
+  std::vector<Strength> strengths_;
+};
+
+}
+
+#endif
@@ -245,8 +245,8 @@ void AeraGraphicsItem::focus()
 
 void AeraGraphicsItem::resetPosition()
 {
-  if (!qIsNaN(aeraEvent_->itemInitialTopLeftPosition_.x()))
-    setPos(aeraEvent_->itemInitialTopLeftPosition_ - boundingRect().topLeft());
+  if (!qIsNaN(aeraEvent_->getItemInitialTopLeftPosition().x()))
+    setPos(aeraEvent_->getItemInitialTopLeftPosition() - boundingRect().topLeft());
 }
 
 void AeraGraphicsItem::centerOn()
@@ -305,7 +305,7 @@ void AeraGraphicsItem::updateArrowsAndLines()
 QVariant AeraGraphicsItem::itemChange(GraphicsItemChange change, const QVariant& value)
 {
   if (change == QGraphicsItem::ItemPositionChange) {
-    aeraEvent_->itemTopLeftPosition_ = boundingRect().topLeft() + value.toPointF();
+    aeraEvent_->setItemTopLeftPosition(boundingRect().topLeft() + value.toPointF());
 
     updateArrowsAndLines();
   }
@@ -418,7 +418,7 @@ void aera_visualizer::AeraGraphicsItem::adjustItemYPosition()
       AeraVisulizerWindow::simulationEventTypes_.end()) {
     return;
   }
-  if (getAeraEvent()->itemInitialTopLeftPosition_ != getAeraEvent()->itemTopLeftPosition_) {
+  if (getAeraEvent()->getItemInitialTopLeftPosition() != getAeraEvent()->getItemTopLeftPosition()) {
     return;
   }
   // Margin between two items
@@ -434,7 +434,11 @@ void aera_visualizer::AeraGraphicsItem::adjustItemYPosition()
       if (!valid_item) {
         continue;
       }
-      if (valid_item->getAeraEvent()->itemInitialTopLeftPosition_ != valid_item->getAeraEvent()->itemTopLeftPosition_) {
+      // Ignore an item which was added after this one in a batch and is waiting to be adjusted.
+      if (parent_->isAwaitingBatchAdjust(valid_item)) {
+        continue;
+      }
+      if (valid_item->getAeraEvent()->getItemInitialTopLeftPosition() != valid_item->getAeraEvent()->getItemTopLeftPosition()) {
         continue;
       }
       // We do not care for sim-items
@@ -460,7 +464,7 @@ void aera_visualizer::AeraGraphicsItem::adjustItemYPosition()
     }
     // Move the current item below the lowest colliding item
     setPos(QPointF(pos().x(), max_y_border + margin + boundingRect().height() / 2));
-    getAeraEvent()->itemInitialTopLeftPosition_ = getAeraEvent()->itemTopLeftPosition_;
+    getAeraEvent()->setItemInitialTopLeftPosition(getAeraEvent()->getItemTopLeftPosition());
   }
 }
 
@@ -251,6 +251,7 @@ protected:
   QPen borderNoHighlightPen_;
 
 private:
+  friend class AeraVisualizerScene;
   void removeArrow(Arrow* arrow);
   void removeHorizontalLine(AnchoredHorizontalLine* line);
 
@@ -54,6 +54,7 @@
 //_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/
 
 #include <algorithm>
+#include <cmath>
 #include "../submodules/AERA/r_exec/factory.h"
 #include "aera-visualizer-window.hpp"
 #include "arrow.hpp"
@@ -64,6 +65,7 @@
 
 #include <QGraphicsSceneMouseEvent>
 #include <QGraphicsView>
+#include <QPainter>
 #include <QApplication>
 
 using namespace std;
@@ -84,6 +86,7 @@ AeraVisualizerScene::AeraVisualizerScene(
   onSceneSelected_(onSceneSelected),
   essencePropertyObject_(replicodeObjects.getObject("essence")),
   didInitialFit_(false),
+  timestampsTop_(0),
   thisFrameTime_(seconds(0)),
   thisFrameLeft_(0),
   borderFlashPen_(Qt::green, 3),
@@ -96,7 +99,10 @@ AeraVisualizerScene::AeraVisualizerScene(
   lineColor_ = Qt::black;
   setBackgroundBrush(QColor(245, 245, 245));
   flashTimerId_ = 0;
+  batchDepth_ = 0;
+  // The scene rect starts with this size and growSceneRect extends it as items are added.
   setSceneRect(QRectF(0, 0, 20000, 20000));
+  setBspTreeDepth(getBspTreeDepth(sceneRect()));
 
   if (isMainScene_) {
     eventTypeFirstTop_[IoDeviceEjectEvent::EVENT_TYPE] = 20;
@@ -134,27 +140,9 @@ void AeraVisualizerScene::addAeraGraphicsItem(AeraGraphicsItem* item)
       view->translate(10 - firstFrameLeft, 0);
       view->setTransformationAnchor(saveAnchor);
 
-      // Separate from the region of I/O device eject/inject events.
-      auto y = eventTypeFirstTop_[AutoFocusNewObjectEvent::EVENT_TYPE] - 5;
-      auto line = addLine(sceneRect().left(), y, sceneRect().right(), y, QPen(Qt::darkGray, 1));
-      line->setZValue(-2000);
-
-      // Add all the frame boundary lines and timestamps.
-      for (auto frameTime = replicodeObjects_.getTimeReference(); true; frameTime += replicodeObjects_.getSamplingPeriod()) {
-        int frameLeft = getTimelineX(frameTime);
-        if (frameLeft > sceneRect().right())
-          break;
-
-        auto line = addLine(frameLeft, sceneRect().top(), frameLeft, sceneRect().bottom(),
-          QPen(Qt::lightGray, 1, Qt::DashLine));
-        line->setZValue(-2000);
-        auto text = addText(replicodeObjects_.relativeTime(frameTime).c_str());
-        text->setZValue(-100);
-        text->setDefaultTextColor(Qt::darkGray);
-        text->setPos(frameLeft, 0);
-        // Save the text so that we can adjust the position.
-        timestampTexts_.push_back(text);
-      }
+      // From now on, drawBackground draws the frame boundary lines and timestamps.
+      timestampsTop_ = view->mapToScene(0, 0).y();
+      invalidate(sceneRect(), QGraphicsScene::BackgroundLayer);
     }
   }
 
@@ -168,7 +156,7 @@ void AeraVisualizerScene::addAeraGraphicsItem(AeraGraphicsItem* item)
     (AeraVisulizerWindow::simulationEventTypes_.find(item->getAeraEvent()->eventType_) !=
      AeraVisulizerWindow::simulationEventTypes_.end());
 
-  if (qIsNaN(aeraEvent->itemTopLeftPosition_.x())) {
+  if (qIsNaN(aeraEvent->getItemTopLeftPosition().x())) {
     // Assign an initial position.
     // Only update positions based on time for the main scehe.
     if (isMainScene_ && aeraEvent->time_ >= thisFrameTime_ + replicodeObjects_.getSamplingPeriod()) {
@@ -245,7 +233,7 @@ void AeraVisualizerScene::addAeraGraphicsItem(AeraGraphicsItem* item)
       else
         left = thisFrameLeft_ + 5;
     }
-    aeraEvent->itemTopLeftPosition_ = QPointF(left, top);
+    aeraEvent->setItemTopLeftPosition(QPointF(left, top));
 
     // Set up eventTypeNextTop_ or simulation next top for the next item.
     qreal nextTop = top + item->boundingRect().height() + verticalMargin;
@@ -259,24 +247,251 @@ void AeraVisualizerScene::addAeraGraphicsItem(AeraGraphicsItem* item)
       eventTypeNextTop_[eventType] = nextTop;
   }
 
-  if (qIsNaN(aeraEvent->itemInitialTopLeftPosition_.x()))
+  if (qIsNaN(aeraEvent->getItemInitialTopLeftPosition().x()))
     // Save the initial position for "Reset Position".
-    aeraEvent->itemInitialTopLeftPosition_ = aeraEvent->itemTopLeftPosition_;
+    aeraEvent->setItemInitialTopLeftPosition(aeraEvent->getItemTopLeftPosition());
 
   addItem(item);
+  insertItemIndexes(item);
   // Adjust the position from the topLeft.
-  item->setPos(aeraEvent->itemTopLeftPosition_ - item->boundingRect().topLeft());
-  item->adjustItemYPosition();
+  item->setPos(aeraEvent->getItemTopLeftPosition() - item->boundingRect().topLeft());
+  growSceneRect(item->sceneBoundingRect());
+  if (batchDepth_ > 0) {
+    // endBatch will adjust the position.
+    batchItems_.push_back(item);
+    batchUnadjustedItems_.insert(item);
+  }
+  else
+    item->adjustItemYPosition();
+}
+
+void AeraVisualizerScene::growSceneRect(const QRectF& itemRect)
+{
+  // Leave room for the next frame and for adjustItemYPosition to move the item down.
+  qreal neededRight = itemRect.right() + frameWidth_;
+  qreal neededBottom = itemRect.bottom() + itemRect.height() + frameWidth_;
+  QRectF rect = sceneRect();
+  if (neededRight <= rect.right() && neededBottom <= rect.bottom())
+    return;
+
+  // Double the size so that the scene index is rebuilt a logarithmic number of times.
+  while (rect.right() < neededRight)
+    rect.setWidth(rect.width() * 2);
+  while (rect.bottom() < neededBottom)
+    rect.setHeight(rect.height() * 2);
+  setSceneRect(rect);
+  setBspTreeDepth(getBspTreeDepth(rect));
+}
+
+int AeraVisualizerScene::getBspTreeDepth(const QRectF& rect)
+{
+  // Each pair of levels divides the scene in both directions. Aim for leaves which are about
+  // maxBspLeafSize_ on the longest side, but limit the depth because Qt allocates 2^depth leaves.
+  qreal cells = max(rect.width(), rect.height()) / maxBspLeafSize_;
+  int depth = 2 * (int)ceil(log2(max(cells, (qreal)1)));
+  return min(max(depth, 4), 16);
+}
+
+void AeraVisualizerScene::beginBatch()
+{
+  if (batchDepth_++ > 0)
+    // Already in a batch.
+    return;
+
+  foreach(QGraphicsView* view, views())
+    view->viewport()->setUpdatesEnabled(false);
+}
+
+void AeraVisualizerScene::endBatch()
+{
+  if (batchDepth_ <= 0 || --batchDepth_ > 0)
+    // Not the end of the outermost batch.
+    return;
+
+  // Adjust the items in the order they were added. Each one ignores the items after it, the
+  // same as if it was adjusted when it was added.
+  for (size_t i = 0; i < batchItems_.size(); ++i) {
+    batchUnadjustedItems_.erase(batchItems_[i]);
+    batchItems_[i]->adjustItemYPosition();
+    batchItems_[i]->updateArrowsAndLines();
+  }
+  batchItems_.clear();
+
+  if (!flashingItems_.empty() && flashTimerId_ == 0)
+    // Start the timer deferred by establishFlashTimer.
+    flashTimerId_ = startTimer(200);
+
+  // This repaints the views.
+  foreach(QGraphicsView* view, views())
+    view->viewport()->setUpdatesEnabled(true);
+}
+
+void AeraVisualizerScene::removeAeraGraphicsItem(AeraGraphicsItem* item)
+{
+  if (batchUnadjustedItems_.erase(item) > 0)
+    batchItems_.erase(find(batchItems_.begin(), batchItems_.end(), item));
+
+  eraseItemIndexes(item);
+  item->removeArrowsAndHorizontalLines();
+  removeItem(item);
+  delete item;
+}
+
+void AeraVisualizerScene::insertItemIndexes(AeraGraphicsItem* item)
+{
+  objectItems_.insert(make_pair(item->getAeraEvent()->object_, item));
+  eventTypeItems_[item->getAeraEvent()->eventType_].insert(item);
+  auto property = getAutoFocusProperty(item);
+  if (property)
+    autoFocusPropertyItems_[property].insert(item);
+}
+
+void AeraVisualizerScene::eraseItemIndexes(AeraGraphicsItem* item)
+{
+  auto range = objectItems_.equal_range(item->getAeraEvent()->object_);
+  for (auto entry = range.first; entry != range.second; ++entry) {
+    if (entry->second == item) {
+      objectItems_.erase(entry);
+      break;
+    }
+  }
+
+  eventTypeItems_[item->getAeraEvent()->eventType_].erase(item);
+  flashingItems_.erase(item);
+  auto property = getAutoFocusProperty(item);
+  if (property)
+    autoFocusPropertyItems_[property].erase(item);
+}
+
+Code* AeraVisualizerScene::getAutoFocusProperty(AeraGraphicsItem* item)
+{
+  if (!dynamic_cast<AutoFocusFactItem*>(item))
+    return 0;
+
+  auto mkVal = item->getAeraEvent()->object_->get_reference(0);
+  // TODO: Is this reference always the property?
+  if (mkVal->references_size() < 2)
+    return 0;
+  return mkVal->get_reference(1);
+}
+
+void AeraVisualizerScene::removeAeraGraphicsItems(const unordered_set<AeraEvent*>& aeraEvents)
+{
+  if (aeraEvents.empty())
+    return;
+
+  unordered_set<AeraGraphicsItem*> toDelete;
+  for (auto aeraEvent = aeraEvents.begin(); aeraEvent != aeraEvents.end(); ++aeraEvent) {
+    auto range = objectItems_.equal_range((*aeraEvent)->object_);
+    for (auto entry = range.first; entry != range.second; ++entry) {
+      if (entry->second->getAeraEvent() == *aeraEvent)
+        toDelete.insert(entry->second);
+    }
+  }
+  if (toDelete.empty())
+    return;
+
+  // An arrow between two removed items is in the list of both, so collect them in a set.
+  unordered_set<Arrow*> arrows;
+  for (auto item = toDelete.begin(); item != toDelete.end(); ++item) {
+    foreach(Arrow* arrow, (*item)->arrows_)
+      arrows.insert(arrow);
+  }
+
+  for (auto arrow = arrows.begin(); arrow != arrows.end(); ++arrow) {
+    auto startItem = dynamic_cast<AeraGraphicsItem*>((*arrow)->startItem());
+    if (startItem && toDelete.find(startItem) == toDelete.end())
+      startItem->removeArrow(*arrow);
+    auto endItem = dynamic_cast<AeraGraphicsItem*>((*arrow)->endItem());
+    if (endItem && toDelete.find(endItem) == toDelete.end())
+      endItem->removeArrow(*arrow);
+    removeItem(*arrow);
+    delete *arrow;
+  }
+
+  for (auto item = toDelete.begin(); item != toDelete.end(); ++item) {
+    // A horizontal line only belongs to its item.
+    foreach(AnchoredHorizontalLine* line, (*item)->horizontalLines_) {
+      removeItem(line);
+      delete line;
+    }
+
+    if (batchUnadjustedItems_.erase(*item) > 0)
+      batchItems_.erase(find(batchItems_.begin(), batchItems_.end(), *item));
+    eraseItemIndexes(*item);
+    removeItem(*item);
+    delete *item;
+  }
 }
 
 void AeraVisualizerScene::onViewMoved()
 {
-  if (views().size() >= 1) {
-    // Always position the timestamps at the top of the screen.
-    qreal sceneY = views().at(0)->mapToScene(0, 0).y();
-    foreach(QGraphicsTextItem * text, timestampTexts_)
-      text->setPos(text->x(), sceneY);
+  if (!isMainScene_ || views().size() < 1)
+    return;
+
+  // The timestamps are always at the top of the screen.
+  QGraphicsView* view = views().at(0);
+  qreal sceneY = view->mapToScene(0, 0).y();
+  if (sceneY == timestampsTop_)
+    // Only scrolled horizontally, which repaints the exposed background.
+    return;
+
+  // The view scrolled the old timestamps with the contents, so repaint them and the new ones.
+  int oldTop = view->mapFromScene(0, timestampsTop_).y();
+  timestampsTop_ = sceneY;
+  int height = (int)ceil(getTimestampsHeight() * view->transform().m22()) + 1;
+  view->viewport()->update(0, oldTop, view->viewport()->width(), height);
+  view->viewport()->update(0, 0, view->viewport()->width(), height);
+}
+
+void AeraVisualizerScene::drawBackground(QPainter* painter, const QRectF& rect)
+{
+  QGraphicsScene::drawBackground(painter, rect);
+  if (!isMainScene_ || !didInitialFit_)
+    return;
+
+  QRectF exposed = rect.intersected(sceneRect());
+  if (exposed.isEmpty())
+    return;
+
+  painter->save();
+
+  // Separate from the region of I/O device eject/inject events.
+  auto y = eventTypeFirstTop_[AutoFocusNewObjectEvent::EVENT_TYPE] - 5;
+  if (y >= exposed.top() && y <= exposed.bottom()) {
+    painter->setPen(QPen(Qt::darkGray, 1));
+    painter->drawLine(QPointF(exposed.left(), y), QPointF(exposed.right(), y));
   }
+
+  // Only draw the frames in the exposed rect. Frame n starts at getTimelineX of the time reference
+  // plus n sampling periods, which is n * frameWidth_.
+  int firstFrame = (int)floor(exposed.left() / frameWidth_);
+  int lastFrame = (int)floor(exposed.right() / frameWidth_);
+
+  painter->setPen(QPen(Qt::lightGray, 1, Qt::DashLine));
+  for (int frame = firstFrame; frame <= lastFrame; ++frame) {
+    qreal frameLeft = frame * frameWidth_;
+    if (frameLeft >= exposed.left())
+      painter->drawLine(QPointF(frameLeft, exposed.top()), QPointF(frameLeft, exposed.bottom()));
+  }
+
+  // Draw the timestamps at the top of the screen, if they are in the exposed rect.
+  qreal timestampsTop = views().at(0)->mapToScene(0, 0).y();
+  qreal timestampsHeight = getTimestampsHeight();
+  if (timestampsTop <= exposed.bottom() && timestampsTop + timestampsHeight >= exposed.top()) {
+    painter->setPen(Qt::darkGray);
+    painter->setFont(font());
+    // Include the previous frame, whose timestamp may extend into the exposed rect.
+    for (int frame = max(firstFrame - 1, 0); frame <= lastFrame; ++frame) {
+      auto frameTime = replicodeObjects_.getTimeReference() + frame * replicodeObjects_.getSamplingPeriod();
+      painter->drawText(
+        QRectF(frame * frameWidth_ + timestampMargin_, timestampsTop + timestampMargin_,
+               frameWidth_, timestampsHeight),
+        Qt::AlignLeft | Qt::AlignTop, replicodeObjects_.relativeTime(frameTime).c_str());
+    }
+  }
+
+  painter->restore();
 }
 
 void AeraVisualizerScene::mousePressEvent(QGraphicsSceneMouseEvent* mouseEvent)
@@ -326,7 +541,8 @@ void AeraVisualizerScene::addArrow(
   endItem->addArrow(arrow);
   arrow->setZValue(-1000.0);
   addItem(arrow);
-  arrow->updatePosition();
+  if (!(isAwaitingBatchAdjust(startItem) || isAwaitingBatchAdjust(endItem)))
+    arrow->updatePosition();
 }
 
 void AeraVisualizerScene::addHorizontalLine(AeraGraphicsItem* item)
@@ -359,19 +575,16 @@ void AeraVisualizerScene::addHorizontalLine(AeraGraphicsItem* item)
     item->addHorizontalLine(line);
     line->setZValue(-1001.0);
     addItem(line);
-    line->updatePosition();
+    if (!isAwaitingBatchAdjust(item))
+      line->updatePosition();
   }
 }
 
 AeraGraphicsItem* AeraVisualizerScene::getAeraGraphicsItem(Code* object)
 {
-  foreach(QGraphicsItem* item, items()) {
-    auto graphicsItem = dynamic_cast<AeraGraphicsItem*>(item);
-    if (graphicsItem) {
-      if (graphicsItem->getAeraEvent()->object_ == object)
-        return graphicsItem;
-    }
-  }
+  auto entry = objectItems_.find(object);
+  if (entry != objectItems_.end())
+    return entry->second;
 
   return 0;
 }
@@ -460,21 +673,27 @@ void AeraVisualizerScene::scrollToTimestamp(core::Timestamp timestamp) {
 
 void AeraVisualizerScene::setItemsVisible(int eventType, bool visible)
 {
-  foreach(QGraphicsItem * item, items()) {
-    auto aeraGraphicsItem = dynamic_cast<AeraGraphicsItem*>(item);
-    if (aeraGraphicsItem && aeraGraphicsItem->getAeraEvent()->eventType_ == eventType)
-      aeraGraphicsItem->setItemAndArrowsAndHorizontalLinesVisible(visible);
-  }
+  auto items = eventTypeItems_.find(eventType);
+  if (items == eventTypeItems_.end())
+    return;
+
+  beginBatch();
+  for (auto item = items->second.begin(); item != items->second.end(); ++item)
+    (*item)->setItemAndArrowsAndHorizontalLinesVisible(visible);
+  endBatch();
 }
 
 void AeraVisualizerScene::setNonItemsVisible(const set<int>& notEventTypes, bool visible)
 {
-  foreach(QGraphicsItem * item, items()) {
-    auto aeraGraphicsItem = dynamic_cast<AeraGraphicsItem*>(item);
-    if (aeraGraphicsItem && 
-        notEventTypes.find(aeraGraphicsItem->getAeraEvent()->eventType_) == notEventTypes.end())
-      aeraGraphicsItem->setItemAndArrowsAndHorizontalLinesVisible(visible);
+  beginBatch();
+  for (auto items = eventTypeItems_.begin(); items != eventTypeItems_.end(); ++items) {
+    if (notEventTypes.find(items->first) != notEventTypes.end())
+      continue;
+
+    for (auto item = items->second.begin(); item != items->second.end(); ++item)
+      (*item)->setItemAndArrowsAndHorizontalLinesVisible(visible);
   }
+  endBatch();
 }
 
 void AeraVisualizerScene::setAutoFocusItemsVisible(const string& property, bool visible)
@@ -482,38 +701,28 @@ void AeraVisualizerScene::setAutoFocusItemsVisible(const string& property, bool
   auto propertyObject = (property == "essence" ? essencePropertyObject_ : replicodeObjects_.getObject(property));
   if (!propertyObject)
     return;
+  auto items = autoFocusPropertyItems_.find(propertyObject);
+  if (items == autoFocusPropertyItems_.end())
+    return;
 
-  foreach(QGraphicsItem * item, items()) {
-    auto autoFocusItem = dynamic_cast<AutoFocusFactItem*>(item);
-    if (autoFocusItem) {
-      auto mkVal = autoFocusItem->getAeraEvent()->object_->get_reference(0);
-      // TODO: Is this reference always the property?
-      if (mkVal->references_size() < 2)
-        continue;
-
-      auto mkValProperty = mkVal->get_reference(1);
-      if (mkValProperty == propertyObject)
-        autoFocusItem->setItemAndArrowsAndHorizontalLinesVisible(visible);
-    }
-  }
+  beginBatch();
+  for (auto item = items->second.begin(); item != items->second.end(); ++item)
+    (*item)->setItemAndArrowsAndHorizontalLinesVisible(visible);
+  endBatch();
 }
 
 void AeraVisualizerScene::removeAllItemsByEventType(const set<int>& eventTypes)
 {
-  // First find the items to delete without deleting, which modifies items().
+  // First find the items to delete without deleting, which modifies eventTypeItems_.
   vector<AeraGraphicsItem*> toDelete;
-  foreach(QGraphicsItem * item, items()) {
-    auto aeraGraphicsItem = dynamic_cast<AeraGraphicsItem*>(item);
-    if (aeraGraphicsItem &&
-      eventTypes.find(aeraGraphicsItem->getAeraEvent()->eventType_) != eventTypes.end())
-      toDelete.push_back(aeraGraphicsItem);
+  for (auto eventType = eventTypes.begin(); eventType != eventTypes.end(); ++eventType) {
+    auto items = eventTypeItems_.find(*eventType);
+    if (items != eventTypeItems_.end())
+      toDelete.insert(toDelete.end(), items->second.begin(), items->second.end());
   }
 
-  for (auto item = toDelete.begin(); item != toDelete.end(); ++item) {
-    (*item)->removeArrowsAndHorizontalLines();
-    removeItem(*item);
-    delete *item;
-  }
+  for (auto item = toDelete.begin(); item != toDelete.end(); ++item)
+    removeAeraGraphicsItem(*item);
 }
 
 #if QT_CONFIG(wheelevent)
@@ -535,11 +744,9 @@ void AeraVisualizerScene::timerEvent(QTimerEvent* event)
     // This timer event is not for us.
     return;
 
-  bool isFlashing = false;
-  foreach(QGraphicsItem* item, items()) {
-    auto aeraGraphicsItem = dynamic_cast<AeraGraphicsItem*>(item);
-    if (!aeraGraphicsItem)
-      continue;
+  for (auto flashingItem = flashingItems_.begin(); flashingItem != flashingItems_.end();) {
+    auto aeraGraphicsItem = *flashingItem;
+    bool isFlashing = false;
 
     if (aeraGraphicsItem->borderFlashCountdown_ > 0) {
       isFlashing = true;
@@ -551,7 +758,7 @@ void AeraVisualizerScene::timerEvent(QTimerEvent* event)
         aeraGraphicsItem->setPen(aeraGraphicsItem->getBorderNoHighlightPen());
     }
 
-    auto modelItem = dynamic_cast<ModelItem*>(item);
+    auto modelItem = dynamic_cast<ModelItem*>(aeraGraphicsItem);
     if (modelItem) {
       if (modelItem->strengthFlashCountdown_ > 0) {
         isFlashing = true;
@@ -586,9 +793,15 @@ void AeraVisualizerScene::timerEvent(QTimerEvent* event)
           modelItem->setSuccessRateColor(noFlashColor_);
       }
     }
+
+    if (isFlashing)
+      ++flashingItem;
+    else
+      // The countdowns are finished.
+      flashingItem = flashingItems_.erase(flashingItem);
   }
 
-  if (!isFlashing) {
+  if (flashingItems_.empty()) {
     killTimer(flashTimerId_);
     flashTimerId_ = 0;
   }
@@ -56,11 +56,15 @@
 #define AERA_VISUALIZER_SCENE_HPP
 
 #include <map>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
 #include "../aera-event.hpp"
 #include "aera-graphics-item.hpp"
 #include "../replicode-objects.hpp"
 
 #include <QGraphicsScene>
+#include <QFontMetricsF>
 
 class QGraphicsSceneMouseEvent;
 class QMenu;
@@ -103,7 +107,8 @@ public:
   }
 
   /**
-   * This is called by the QGraphicsView instance when the view is moved.
+   * This is called by the QGraphicsView instance when the view is moved. If it moved vertically,
+   * repaint the timestamps which drawBackground keeps at the top of the view.
    */
   void onViewMoved();
 
@@ -116,6 +121,18 @@ public:
     focusSimulationDetailOids_ = focusSimulationDetailOids;
   }
 
+  /**
+   * Check if the item was added in the current batch and endBatch has not yet adjusted its
+   * position. AeraGraphicsItem::adjustItemYPosition ignores these items, as if they were
+   * not added yet.
+   * \param item The item.
+   * \return True if the item is waiting for endBatch.
+   */
+  bool isAwaitingBatchAdjust(AeraGraphicsItem* item) const
+  {
+    return batchUnadjustedItems_.find(item) != batchUnadjustedItems_.end();
+  }
+
   // The initial value for the flash countdown;
   static const int FLASH_COUNT = 6;
 
@@ -123,6 +140,12 @@ protected:
   void mousePressEvent(QGraphicsSceneMouseEvent* mouseEvent) override;
   void mouseReleaseEvent(QGraphicsSceneMouseEvent* mouseEvent) override;
   void timerEvent(QTimerEvent* event) override;
+
+  /**
+   * Draw the background, and for the main scene draw the frame boundary lines and the timestamps
+   * at the top of the view. Only draw the frames in the exposed rect.
+   */
+  void drawBackground(QPainter* painter, const QRectF& rect) override;
 #if QT_CONFIG(wheelevent)
   void wheelEvent(QGraphicsSceneWheelEvent* event) override;
 #endif
@@ -154,28 +177,105 @@ private:
    * \return The AeraGraphicsItem, or null if not found.
    */
   AeraGraphicsItem* getAeraGraphicsItem(r_code::Code* object);
-  void establishFlashTimer()
+
+  /**
+   * Add the item to flashingItems_ and start the flash timer if it is not running. Call this
+   * after setting the item's flash countdowns. The timer only visits the items in flashingItems_.
+   * \param item The item which is flashing.
+   */
+  void establishFlashTimer(AeraGraphicsItem* item)
   {
-    if (flashTimerId_ == 0)
+    flashingItems_.insert(item);
+    // In a batch, endBatch will start the timer.
+    if (batchDepth_ == 0 && flashTimerId_ == 0)
       flashTimerId_ = startTimer(200);
   }
 
   /**
-   * Find all items with the given event type, and call setItemAndArrowsAndHorizontalLinesVisible.
+   * Start a batch of changes to the scene, such as the events of one play tick or step. Until
+   * the matching endBatch, addAeraGraphicsItem, addArrow, addHorizontalLine and
+   * establishFlashTimer defer adjusting the new item's position, updating the position of its
+   * arrows and lines, and starting the flash timer, and the views don't repaint. Because the
+   * collision queries of adjustItemYPosition are deferred, the scene index is updated once for
+   * the batch instead of for each item. Calls may be nested.
+   */
+  void beginBatch();
+
+  /**
+   * End the batch started by beginBatch. At the end of the outermost batch, adjust the new items
+   * in the order they were added, update their arrows and lines, start the flash timer if
+   * needed, and repaint the views once.
+   */
+  void endBatch();
+
+  /**
+   * If the item rect is near the right or bottom of the scene rect, double the scene rect until
+   * it fits, and set the BSP tree depth for the new size with getBspTreeDepth. This lets the
+   * timeline grow for long runs.
+   * \param itemRect The scene bounding rect of the added item.
+   */
+  void growSceneRect(const QRectF& itemRect);
+
+  /**
+   * Get the BSP tree depth for the scene index, based on the size of the scene rect.
+   * \param rect The scene rect.
+   * \return The depth for setBspTreeDepth.
+   */
+  static int getBspTreeDepth(const QRectF& rect);
+
+  /**
+   * Remove the item's arrows and horizontal lines, remove it from the scene and delete it.
+   * \param item The item to delete.
+   */
+  void removeAeraGraphicsItem(AeraGraphicsItem* item);
+
+  /**
+   * Remove the items of the given events in one pass. Find the items with objectItems_,
+   * then remove and delete each of their arrows and horizontal lines once, only detaching an
+   * arrow from an item which is not also removed, then remove and delete the items.
+   * \param aeraEvents The events whose items should be removed. An event with no item is ignored.
+   */
+  void removeAeraGraphicsItems(const std::unordered_set<AeraEvent*>& aeraEvents);
+
+  /**
+   * Add the item to objectItems_, eventTypeItems_ and autoFocusPropertyItems_, when it is added to the scene.
+   * \param item The item.
+   */
+  void insertItemIndexes(AeraGraphicsItem* item);
+
+  /**
+   * Erase the item from objectItems_, eventTypeItems_, autoFocusPropertyItems_ and flashingItems_,
+   * when it is removed from the scene.
+   * \param item The item.
+   */
+  void eraseItemIndexes(AeraGraphicsItem* item);
+
+  /**
+   * If the item is an AutoFocusFactItem whose object_ is (fact (mk.val X property Y)), get the property.
+   * \param item The item.
+   * \return The property object, or null if not an AutoFocusFactItem with a property.
+   */
+  static r_code::Code* getAutoFocusProperty(AeraGraphicsItem* item);
+
+  /**
+   * Call setItemAndArrowsAndHorizontalLinesVisible for all items with the given event type, found with
+   * eventTypeItems_. The views are repainted once at the end.
    * \param eventType The event type of the item's getAeraEvent().
    * \param visible The visible state for setItemAndArrowsAndHorizontalLinesVisible.
    */
   void setItemsVisible(int eventType, bool visible);
 
   /**
-   * Find all items where the event type is not any of the given values, and call setItemAndArrowsAndHorizontalLinesVisible.
+   * Call setItemAndArrowsAndHorizontalLinesVisible for all items where the event type is not any of the
+   * given values, found with eventTypeItems_. The views are repainted once at the end.
    * \param notEventTypes Call setItemAndArrowsAndHorizontalLinesVisible if the event type of the item's getAeraEvent() is not any of these values.
    * \param visible The visible state for setItemAndArrowsAndHorizontalLinesVisible.
    */
   void setNonItemsVisible(const std::set<int>& notEventTypes, bool visible);
 
   /**
-   * Find all AutoFocusFactItem whose object_ is (fact (mk.val X property Y)), and call setItemAndArrowsAndHorizontalLinesVisible.
+   * Call setItemAndArrowsAndHorizontalLinesVisible for all AutoFocusFactItem whose object_ is
+   * (fact (mk.val X property Y)), found with autoFocusPropertyItems_. The views are repainted once at the end.
    * \param property The event type of the item's object_ mk.val.
    * \param visible The visible state for setItemAndArrowsAndHorizontalLinesVisible.
    */
@@ -194,7 +294,8 @@ private:
   OnSceneSelected onSceneSelected_;
   r_code::Code* essencePropertyObject_;
   bool didInitialFit_;
-  QList<QGraphicsTextItem*> timestampTexts_;
+  // The scene Y of the top of the view when onViewMoved last repainted the timestamps.
+  qreal timestampsTop_;
   // key: The AeraEvent eventType_, or 0 for "other". value: The top of the first item for that event type.
   std::map<int, qreal> eventTypeFirstTop_;
   // key: The AeraEvent eventType_, or 0 for "other". value: The top to use for the next item added for that event type.
@@ -211,8 +312,30 @@ private:
   QString valueUpFlashColor_;
   QString valueDownFlashColor_;
   int flashTimerId_;
+  int batchDepth_;
+  // The items added in the current batch, in the order added.
+  std::vector<AeraGraphicsItem*> batchItems_;
+  std::unordered_set<AeraGraphicsItem*> batchUnadjustedItems_;
+  // key: The object_ of the item's getAeraEvent(). value: The item. Updated when an item is added
+  // or removed. More than one item can have the same object, or a null object.
+  std::unordered_multimap<r_code::Code*, AeraGraphicsItem*> objectItems_;
+  // key: The AeraEvent eventType_. value: The items with the event type.
+  std::unordered_map<int, std::unordered_set<AeraGraphicsItem*>> eventTypeItems_;
+  // key: The property of an AutoFocusFactItem, from getAutoFocusProperty. value: The items with the property.
+  std::unordered_map<r_code::Code*, std::unordered_set<AeraGraphicsItem*>> autoFocusPropertyItems_;
+  // The items with a flash countdown which is not zero, from establishFlashTimer.
+  std::unordered_set<AeraGraphicsItem*> flashingItems_;
   std::set<int> focusSimulationDetailOids_;
   static const int frameWidth_ = 330;
+  // The approximate size of the region of a leaf in the scene index, which is a few frames.
+  static const int maxBspLeafSize_ = 4 * frameWidth_;
+  // The margin around a timestamp, the same as the document margin of a QGraphicsTextItem.
+  static const int timestampMargin_ = 4;
+
+  /**
+   * Get the height of the timestamps drawn by drawBackground, including the margins.
+   */
+  qreal getTimestampsHeight() const { return QFontMetricsF(font()).height() + 2 * timestampMargin_; }
 };
 
 }
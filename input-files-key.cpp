@@ -0,0 +1,117 @@
+//_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/
+//_/_/
+//_/_/ AERA Visualizer
+//_/_/ 
+//_/_/ Copyright (c) 2018-2022 Jeff Thompson
+//_/_/ Copyright (c) 2018-2022 Kristinn R. Thorisson
+//_/_/ Copyright (c) 2018-2022 Icelandic Institute for Intelligent Machines
+//_/_/ http://www.iiim.is
+//_/_/
+//_/_/ --- Open-Source BSD License, with CADIA Clause v 1.0 ---
+//_/_/
+//_/_/ Redistribution and use in source and binary forms, with or without
+//_/_/ modification, is permitted provided that the following conditions
+//_/_/ are met:
+//_/_/ - Redistributions of source code must retain the above copyright
+//_/_/   and collaboration notice, this list of conditions and the
+//_/_/   following disclaimer.
+//_/_/ - Redistributions in binary form must reproduce the above copyright
+//_/_/   notice, this list of conditions and the following disclaimer 
+//_/_/   in the documentation and/or other materials provided with 
+//_/_/   the distribution.
+//_/_/
+//_/_/ - Neither the name of its copyright holders nor the names of its
+//_/_/   contributors may be used to endorse or promote products
+//_/_/   derived from this software without specific prior 
+//_/_/   written permission.
+//_/_/   
+//_/_/ - CADIA Clause: The license granted in and to the software 
+//_/_/   under this agreement is a limited-use license. 
+//_/_/   The software may not be used in furtherance of:
+//_/_/    (i)   intentionally causing bodily injury or severe emotional 
+//_/_/          distress to any person;
+//_/_/    (ii)  invading the personal privacy or violating the human 
+//_/_/          rights of any person; or
+//_/_/    (iii) committing or preparing for any act of war.
+//_/_/
+//_/_/ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND 
+//_/_/ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+//_/_/ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF 
+//_/_/ MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+//_/_/ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR 
+//_/_/ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+//_/_/ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, 
+//_/_/ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+//_/_/ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+//_/_/ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+//_/_/ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+//_/_/ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+//_/_/ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY 
+//_/_/ OF SUCH DAMAGE.
+//_/_/ 
+//_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/
+
+#include <algorithm>
+#include <QFile>
+#include <QFileInfo>
+#include <QDataStream>
+#include <QDateTime>
+#include "input-files-key.hpp"
+
+using namespace std;
+
+namespace aera_visualizer {
+
+namespace {
+
+// The partial hash of an input file uses this many bytes at the start and at the end.
+const qint64 HASH_BLOCK_SIZE = 1 << 20;
+
+/**
+ * Get a 64-bit FNV-1a hash of the first and last HASH_BLOCK_SIZE bytes of the file. With the
+ * file size and modification time, this detects a changed file without reading all of it.
+ * \param file The open file.
+ * \param hash Set this to the hash.
+ * \return True for success, false if the file can't be read.
+ */
+bool getPartialHash(QFile& file, quint64& hash)
+{
+  hash = 14695981039346656037ULL;
+  qint64 starts[] = { 0, max((qint64)0, file.size() - HASH_BLOCK_SIZE) };
+  for (int i = 0; i < 2; ++i) {
+    if (!file.seek(starts[i]))
+      return false;
+    QByteArray block = file.read(HASH_BLOCK_SIZE);
+    for (int j = 0; j < block.size(); ++j) {
+      hash ^= (quint8)block[j];
+      hash *= 1099511628211ULL;
+    }
+  }
+
+  return true;
+}
+
+}
+
+bool getInputFilesKey(const vector<string>& inputFilePaths, QByteArray& key)
+{
+  key.clear();
+  QDataStream stream(&key, QIODevice::WriteOnly);
+  stream.setVersion(QDataStream::Qt_5_12);
+  stream << (quint32)inputFilePaths.size();
+  for (size_t i = 0; i < inputFilePaths.size(); ++i) {
+    QFile file(QString::fromStdString(inputFilePaths[i]));
+    if (!file.open(QIODevice::ReadOnly))
+      return false;
+
+    quint64 hash;
+    if (!getPartialHash(file, hash))
+      return false;
+    stream << QFileInfo(file).absoluteFilePath() << (qint64)file.size() <<
+      QFileInfo(file).lastModified().toMSecsSinceEpoch() << hash;
+  }
+
+  return true;
+}
+
+}
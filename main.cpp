@@ -141,10 +141,13 @@ int main(int argv, char *args[])
   progress.show();
   QApplication::processEvents();
 
+  string userClassesFilePath = settingsFileDir.absoluteFilePath(settings.usr_class_path_.c_str()).toStdString();
+  string decompiledFilePath = settingsFileDir.absoluteFilePath(settings.decompilation_file_path_.c_str()).toStdString();
   ReplicodeObjects replicodeObjects;
+  // Keep the compiled image next to settings.xml so that the next launch can skip compiling.
   string error = replicodeObjects.init(
-    settingsFileDir.absoluteFilePath(settings.usr_class_path_.c_str()).toStdString(), 
-    settingsFileDir.absoluteFilePath(settings.decompilation_file_path_.c_str()).toStdString(),
+    userClassesFilePath, decompiledFilePath,
+    settingsFileDir.absoluteFilePath("visualizer_image.cache").toStdString(),
     microseconds(settings.base_period_), progress);
   if (error == "cancel")
     return -1;
@@ -156,8 +159,16 @@ int main(int argv, char *args[])
   AeraVisulizerWindow mainWindow(replicodeObjects);
   mainWindow.setWindowIcon(QIcon(":/images/app.ico"));
 
+  // Keep the parsed events next to settings.xml so that the next launch can skip parsing.
+  vector<string> eventCacheInputFilePaths;
+  eventCacheInputFilePaths.push_back(userClassesFilePath);
+  eventCacheInputFilePaths.push_back(decompiledFilePath);
+  mainWindow.setEventCache(
+    settingsFileDir.absoluteFilePath("visualizer_events.cache").toStdString(), eventCacheInputFilePaths);
   if (!mainWindow.addEvents(runtimeOutputFilePath, progress))
     return -1;
+  // Decompile the source code of the objects in the background, before the items need it.
+  replicodeObjects.startSourceCodeWarmUp();
 
   mainWindow.setWindowTitle(QString("AERA Visualizer - ") + QFileInfo(settings.source_file_name_.c_str()).fileName());
   QScreen* screen = QGuiApplication::primaryScreen();
@@ -0,0 +1,178 @@
+//_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/
+//_/_/
+//_/_/ AERA Visualizer
+//_/_/ 
+//_/_/ Copyright (c) 2018-2022 Jeff Thompson
+//_/_/ Copyright (c) 2018-2022 Kristinn R. Thorisson
+//_/_/ Copyright (c) 2018-2022 Icelandic Institute for Intelligent Machines
+//_/_/ http://www.iiim.is
+//_/_/
+//_/_/ --- Open-Source BSD License, with CADIA Clause v 1.0 ---
+//_/_/
+//_/_/ Redistribution and use in source and binary forms, with or without
+//_/_/ modification, is permitted provided that the following conditions
+//_/_/ are met:
+//_/_/ - Redistributions of source code must retain the above copyright
+//_/_/   and collaboration notice, this list of conditions and the
+//_/_/   following disclaimer.
+//_/_/ - Redistributions in binary form must reproduce the above copyright
+//_/_/   notice, this list of conditions and the following disclaimer 
+//_/_/   in the documentation and/or other materials provided with 
+//_/_/   the distribution.
+//_/_/
+//_/_/ - Neither the name of its copyright holders nor the names of its
+//_/_/   contributors may be used to endorse or promote products
+//_/_/   derived from this software without specific prior 
+//_/_/   written permission.
+//_/_/   
+//_/_/ - CADIA Clause: The license granted in and to the software 
+//_/_/   under this agreement is a limited-use license. 
+//_/_/   The software may not be used in furtherance of:
+//_/_/    (i)   intentionally causing bodily injury or severe emotional 
+//_/_/          distress to any person;
+//_/_/    (ii)  invading the personal privacy or violating the human 
+//_/_/          rights of any person; or
+//_/_/    (iii) committing or preparing for any act of war.
+//_/_/
+//_/_/ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND 
+//_/_/ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+//_/_/ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF 
+//_/_/ MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+//_/_/ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR 
+//_/_/ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+//_/_/ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, 
+//_/_/ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+//_/_/ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+//_/_/ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+//_/_/ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+//_/_/ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+//_/_/ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY 
+//_/_/ OF SUCH DAMAGE.
+//_/_/ 
+//_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/
+
+#include "submodules/AERA/r_exec/opcodes.h"
+#include "model-state-keyframes.hpp"
+
+using namespace std;
+using namespace std::chrono;
+using namespace core;
+using namespace r_code;
+using namespace r_exec;
+
+namespace aera_visualizer {
+
+void ModelStateKeyframes::build(
+  EventStore& events, Timestamp timeReference, microseconds samplingPeriod, int keyframeInterval)
+{
+  keyframeInterval_ = keyframeInterval;
+  initialStates_.clear();
+  keyframes_.clear();
+
+  // Get the initial values of each model which has an event.
+  for (size_t i = 0; i < events.size(); ++i) {
+    if (!isModelStateEventType(events.getType(i)))
+      continue;
+
+    auto model = events.getObject(i);
+    if (initialStates_.find(model) != initialStates_.end())
+      continue;
+    ModelState& state = initialStates_[model];
+    state.strength_ = model->code(MDL_STRENGTH).asFloat();
+    state.evidenceCount_ = model->code(MDL_CNT).asFloat();
+    state.successRate_ = model->code(MDL_SR).asFloat();
+    state.phase_ = PHASE_NORMAL;
+  }
+
+  auto keyframeDuration = samplingPeriod * keyframeInterval_;
+  auto nextKeyframeTime = timeReference + keyframeDuration;
+  ModelStates states;
+  for (size_t i = 0; i < events.size(); ++i) {
+    if (keyframeInterval_ > 0 && events.getTime(i) >= nextKeyframeTime) {
+      // This is the first event of a new keyframe's frame.
+      keyframes_.push_back(Keyframe());
+      keyframes_.back().iEvent_ = i;
+      keyframes_.back().states_ = states;
+      auto relativeTime = duration_cast<microseconds>(events.getTime(i) - timeReference);
+      nextKeyframeTime = events.getTime(i) - (relativeTime % keyframeDuration) + keyframeDuration;
+    }
+
+    int eventType = events.getType(i);
+    if (eventType == SetModelEvidenceCountAndSuccessRateEvent::EVENT_TYPE) {
+      // Save the current values for a later undo, as stepEvent would.
+      auto found = states.find(events.getObject(i));
+      const ModelState& state = (found != states.end() ? found->second : initialStates_.at(events.getObject(i)));
+      auto& values = events.getEvidenceCountAndSuccessRate(i);
+      values.oldEvidenceCount_ = state.evidenceCount_;
+      values.oldSuccessRate_ = state.successRate_;
+    }
+    else if (eventType == SetModelStrengthEvent::EVENT_TYPE) {
+      auto found = states.find(events.getObject(i));
+      const ModelState& state = (found != states.end() ? found->second : initialStates_.at(events.getObject(i)));
+      events.getStrength(i).oldStrength_ = state.strength_;
+    }
+
+    applyEvent(events, i, states);
+  }
+}
+
+void ModelStateKeyframes::getModelStates(const EventStore& events, size_t iEvent, ModelStates& states) const
+{
+  // Find the last keyframe at or before iEvent.
+  auto keyframe = upper_bound(
+    keyframes_.begin(), keyframes_.end(), iEvent,
+    [](size_t i, const Keyframe& k) { return i < k.iEvent_; });
+  size_t iStart = 0;
+  if (keyframe == keyframes_.begin())
+    states.clear();
+  else {
+    --keyframe;
+    states = keyframe->states_;
+    iStart = keyframe->iEvent_;
+  }
+  // A keyframe only has the models changed by an earlier event. Add the initial state of the
+  // other models so that a backward seek restores a model whose first change is later.
+  // (insert does not replace the models which are already in states.)
+  states.insert(initialStates_.begin(), initialStates_.end());
+
+  for (size_t i = iStart; i < iEvent && i < events.size(); ++i) {
+    if (isModelStateEventType(events.getType(i)))
+      applyEvent(events, i, states);
+  }
+}
+
+void ModelStateKeyframes::applyEvent(const EventStore& events, size_t i, ModelStates& states) const
+{
+  int eventType = events.getType(i);
+  if (!isModelStateEventType(eventType))
+    return;
+
+  auto found = states.find(events.getObject(i));
+  if (found == states.end())
+    found = states.insert(*initialStates_.find(events.getObject(i))).first;
+  ModelState& state = found->second;
+
+  if (eventType == NewModelEvent::EVENT_TYPE) {
+    // stepEvent restores the values from the event and makes a new item which is not phased out.
+    auto newModelEvent = (const NewModelEvent*)events.get(i);
+    state.strength_ = newModelEvent->strength_;
+    state.evidenceCount_ = newModelEvent->evidenceCount_;
+    state.successRate_ = newModelEvent->successRate_;
+    state.phase_ = PHASE_NORMAL;
+  }
+  else if (eventType == SetModelEvidenceCountAndSuccessRateEvent::EVENT_TYPE) {
+    auto& values = events.getEvidenceCountAndSuccessRate(i);
+    state.evidenceCount_ = values.evidenceCount_;
+    state.successRate_ = values.successRate_;
+  }
+  else if (eventType == SetModelStrengthEvent::EVENT_TYPE)
+    state.strength_ = events.getStrength(i).strength_;
+  else if (eventType == PhaseInModelEvent::EVENT_TYPE)
+    state.phase_ = PHASE_NORMAL;
+  else if (eventType == PhaseOutModelEvent::EVENT_TYPE)
+    state.phase_ = PHASE_PHASED_OUT;
+  else if (eventType == DeleteModelEvent::EVENT_TYPE)
+    state.phase_ = PHASE_DELETED;
+}
+
+}
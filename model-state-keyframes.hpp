@@ -0,0 +1,158 @@
+//_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/
+//_/_/
+//_/_/ AERA Visualizer
+//_/_/ 
+//_/_/ Copyright (c) 2018-2022 Jeff Thompson
+//_/_/ Copyright (c) 2018-2022 Kristinn R. Thorisson
+//_/_/ Copyright (c) 2018-2022 Icelandic Institute for Intelligent Machines
+//_/_/ http://www.iiim.is
+//_/_/
+//_/_/ --- Open-Source BSD License, with CADIA Clause v 1.0 ---
+//_/_/
+//_/_/ Redistribution and use in source and binary forms, with or without
+//_/_/ modification, is permitted provided that the following conditions
+//_/_/ are met:
+//_/_/ - Redistributions of source code must retain the above copyright
+//_/_/   and collaboration notice, this list of conditions and the
+//_/_/   following disclaimer.
+//_/_/ - Redistributions in binary form must reproduce the above copyright
+//_/_/   notice, this list of conditions and the following disclaimer 
+//_/_/   in the documentation and/or other materials provided with 
+//_/_/   the distribution.
+//_/_/
+//_/_/ - Neither the name of its copyright holders nor the names of its
+//_/_/   contributors may be used to endorse or promote products
+//_/_/   derived from this software without specific prior 
+//_/_/   written permission.
+//_/_/   
+//_/_/ - CADIA Clause: The license granted in and to the software 
+//_/_/   under this agreement is a limited-use license. 
+//_/_/   The software may not be used in furtherance of:
+//_/_/    (i)   intentionally causing bodily injury or severe emotional 
+//_/_/          distress to any person;
+//_/_/    (ii)  invading the personal privacy or violating the human 
+//_/_/          rights of any person; or
+//_/_/    (iii) committing or preparing for any act of war.
+//_/_/
+//_/_/ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND 
+//_/_/ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+//_/_/ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF 
+//_/_/ MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+//_/_/ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR 
+//_/_/ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+//_/_/ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, 
+//_/_/ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+//_/_/ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+//_/_/ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+//_/_/ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+//_/_/ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+//_/_/ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY 
+//_/_/ OF SUCH DAMAGE.
+//_/_/ 
+//_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/
+
+#ifndef MODEL_STATE_KEYFRAMES_HPP
+#define MODEL_STATE_KEYFRAMES_HPP
+
+#include <vector>
+#include <unordered_map>
+#include "event-store.hpp"
+
+namespace aera_visualizer {
+
+/**
+ * ModelStateKeyframes has a periodic snapshot of the strength, evidence count, success rate
+ * and phase of every model, as they are after stepping all the events before the keyframe.
+ * To seek, the visualizer only creates and removes the items between the current event and
+ * the target event, then uses getModelStates to set the models from the nearest keyframe,
+ * replaying only the model events after it. (The existing items and their positions follow
+ * from the event index, since each event saves the position of its item.)
+ */
+class ModelStateKeyframes {
+public:
+  enum Phase {
+    PHASE_NORMAL,
+    PHASE_PHASED_OUT,
+    PHASE_DELETED
+  };
+
+  struct ModelState {
+    core::float32 strength_;
+    core::float32 evidenceCount_;
+    core::float32 successRate_;
+    Phase phase_;
+  };
+
+  typedef std::unordered_map<r_code::Code*, ModelState> ModelStates;
+
+  ModelStateKeyframes()
+  : keyframeInterval_(0)
+  {}
+
+  /**
+   * Step through the model events once to make the keyframes. This also sets the old values
+   * of each SetModelEvidenceCountAndSuccessRateEvent and SetModelStrengthEvent in the events
+   * side tables so that they can be unstepped even if a seek did not step them. Call this after all events are added
+   * and before stepping, while each model object still has its initial values.
+   * \param events The events.
+   * \param timeReference The time reference of the events.
+   * \param samplingPeriod The sampling period, which is the length of a frame.
+   * \param keyframeInterval The number of frames between keyframes. A smaller interval has
+   * more keyframes which use more memory, but a seek replays fewer events. If 0, don't make
+   * keyframes, and getModelStates replays from the first event.
+   */
+  void build(
+    EventStore& events, core::Timestamp timeReference, std::chrono::microseconds samplingPeriod,
+    int keyframeInterval);
+
+  /**
+   * Get the model states after stepping the events before iEvent. This copies the nearest
+   * keyframe at or before iEvent and replays the model events from there.
+   * \param events The events given to build().
+   * \param iEvent The index of the next event to step.
+   * \param states Set this to the model states. This has every model with a model state
+   * event. A model whose first event is at or after iEvent has its initial state.
+   */
+  void getModelStates(const EventStore& events, size_t iEvent, ModelStates& states) const;
+
+  /**
+   * Check if the event type changes a model's state.
+   * \param eventType The AeraEvent eventType_.
+   * \return True if it is a model state event type.
+   */
+  static bool isModelStateEventType(int eventType)
+  {
+    return eventType == NewModelEvent::EVENT_TYPE ||
+      eventType == SetModelEvidenceCountAndSuccessRateEvent::EVENT_TYPE ||
+      eventType == SetModelStrengthEvent::EVENT_TYPE ||
+      eventType == PhaseInModelEvent::EVENT_TYPE ||
+      eventType == PhaseOutModelEvent::EVENT_TYPE ||
+      eventType == DeleteModelEvent::EVENT_TYPE;
+  }
+
+private:
+  struct Keyframe {
+    // The index of the first event not included in the keyframe.
+    size_t iEvent_;
+    ModelStates states_;
+  };
+
+  /**
+   * Update states for the event, if it is a model state event.
+   * \param events The events.
+   * \param i The index of the event.
+   * \param states The model states to update. If the event's model is not in states, first
+   * add it from initialStates_.
+   */
+  void applyEvent(const EventStore& events, size_t i, ModelStates& states) const;
+
+  int keyframeInterval_;
+  // The model states before the first event, for each model which has a model state event.
+  ModelStates initialStates_;
+  // Sorted by iEvent_.
+  std::vector<Keyframe> keyframes_;
+};
+
+}
+
+#endif
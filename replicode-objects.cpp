@@ -54,13 +54,19 @@
 #include <fstream>
 #include <sstream>
 #include <algorithm>
+#include <cstring>
+#include <cctype>
 #include "submodules/AERA/r_comp/preprocessor.h"
 #include "submodules/AERA/r_comp/compiler.h"
 #include "submodules/AERA/r_comp/decompiler.h"
+#include "submodules/AERA/r_code/image.h"
 #include "submodules/AERA/r_exec/model_base.h"
+#include "input-files-key.hpp"
 #include "replicode-objects.hpp"
 #include <QApplication>
 #include <QProgressDialog>
+#include <QFile>
+#include <QSaveFile>
 
 using namespace std;
 using namespace std::chrono;
@@ -71,7 +77,213 @@ using namespace r_exec;
 
 namespace aera_visualizer {
 
+namespace {
+
+// The first value in the compiled image cache file.
+const uint32 IMAGE_CACHE_MAGIC = 0x41564943;
+// Increment this when changing the format of the compiled image cache file.
+const uint32 IMAGE_CACHE_FORMAT_VERSION = 1;
+
+// The image cache file is only read on the same machine, so write values in the native byte order.
+template<class T> void writeValue(ostream& stream, const T& value)
+{
+  stream.write((const char*)&value, sizeof(value));
+}
+
+template<class T> bool readValue(istream& stream, T& value)
+{
+  return !!stream.read((char*)&value, sizeof(value));
+}
+
+void writeString(ostream& stream, const string& value)
+{
+  writeValue(stream, (uint32)value.size());
+  stream.write(value.data(), value.size());
+}
+
+/**
+ * If the text at p starts with the literal, then advance p past it.
+ * \return True if the literal matched.
+ */
+bool parseLiteral(const char*& p, const char* end, const char* literal)
+{
+  size_t size = strlen(literal);
+  if ((size_t)(end - p) < size || memcmp(p, literal, size) != 0)
+    return false;
+  p += size;
+  return true;
+}
+
+/**
+ * Parse one or more decimal digits at p and advance p past them.
+ * \return True if there is at least one digit.
+ */
+bool parseNumber(const char*& p, const char* end, uint64& value)
+{
+  const char* start = p;
+  value = 0;
+  for (; p < end && *p >= '0' && *p <= '9'; ++p)
+    value = 10 * value + (*p - '0');
+  return p > start;
+}
+
+/**
+ * Parse a line of the decompiled objects file which starts an object, for example
+ * "52(1452) mdl_52:(mdl ..." or, without an OID, "(1453) mdl_53:(mdl ...".
+ * \param line The start of the line.
+ * \param end The end of the line, without the newline.
+ * \param hasOid True to parse the form with the OID. In this form, the label can't have a '.'.
+ * \param oid Set this to the OID, or UNDEFINED_OID if not hasOid.
+ * \param detailOid Set this to the detail OID.
+ * \param name Set this to the start of the label.
+ * \param nameEnd Set this to the end of the label, which is followed by ':' and the source code.
+ * \return True if the line has the form.
+ */
+bool parseObjectLine(const char* line, const char* end, bool hasOid, uint32& oid, uint64& detailOid,
+  const char*& name, const char*& nameEnd)
+{
+  const char* p = line;
+  oid = UNDEFINED_OID;
+  if (hasOid) {
+    uint64 value;
+    if (!parseNumber(p, end, value))
+      return false;
+    oid = (uint32)value;
+  }
+  if (!parseLiteral(p, end, "(") || !parseNumber(p, end, detailOid) || !parseLiteral(p, end, ") "))
+    return false;
+
+  name = p;
+  while (p < end && (isalnum((unsigned char)*p) || *p == '_' || (!hasOid && *p == '.')))
+    ++p;
+  // The label must be followed by ':' and at least one character of source code.
+  if (p == name || end - p < 2 || *p != ':')
+    return false;
+  nameEnd = p;
+  return true;
+}
+
+/**
+ * A MemoryStreambuf reads a buffer in place, so that an istream can read a string without copying it.
+ * This supports tellg for the error position from the compiler.
+ */
+class MemoryStreambuf : public streambuf {
+public:
+  MemoryStreambuf(const char* data, size_t size)
+  {
+    char* begin = const_cast<char*>(data);
+    setg(begin, begin, begin + size);
+  }
+
+protected:
+  pos_type seekoff(off_type offset, ios_base::seekdir direction, ios_base::openmode which) override
+  {
+    if (!(which & ios_base::in))
+      return pos_type(off_type(-1));
+
+    char* base = (direction == ios_base::beg ? eback() : direction == ios_base::cur ? gptr() : egptr());
+    if (offset < eback() - base || offset > egptr() - base)
+      return pos_type(off_type(-1));
+    setg(eback(), base + offset, egptr());
+    return pos_type(gptr() - eback());
+  }
+
+  pos_type seekpos(pos_type position, ios_base::openmode which) override
+  {
+    return seekoff(off_type(position), ios_base::beg, which);
+  }
+};
+
+/**
+ * A StringStreambuf appends the output of an ostream to a string, so that the output is written
+ * in place instead of to an ostringstream which must be copied out with str().
+ */
+class StringStreambuf : public streambuf {
+public:
+  StringStreambuf(string& value)
+  : value_(value)
+  {}
+
+protected:
+  int_type overflow(int_type c) override
+  {
+    if (!traits_type::eq_int_type(c, traits_type::eof()))
+      value_.push_back(traits_type::to_char_type(c));
+    return traits_type::not_eof(c);
+  }
+
+  streamsize xsputn(const char* data, streamsize size) override
+  {
+    value_.append(data, (size_t)size);
+    return size;
+  }
+
+private:
+  string& value_;
+};
+
+/**
+ * A QIODeviceStreambuf writes the output of an ostream to a QIODevice such as a QSaveFile,
+ * so that code which writes to a std::ostream can write to the device. Check hasError()
+ * after writing.
+ */
+class QIODeviceStreambuf : public streambuf {
+public:
+  QIODeviceStreambuf(QIODevice& device)
+  : device_(device),
+    hasError_(false),
+    bytesWritten_(0)
+  {}
+
+  bool hasError() const { return hasError_; }
+
+  /**
+   * Get the number of bytes written to the device so far.
+   */
+  qint64 bytesWritten() const { return bytesWritten_; }
+
+protected:
+  int_type overflow(int_type c) override
+  {
+    if (traits_type::eq_int_type(c, traits_type::eof()))
+      return traits_type::not_eof(c);
+    if (!device_.putChar(traits_type::to_char_type(c))) {
+      hasError_ = true;
+      return traits_type::eof();
+    }
+    ++bytesWritten_;
+    return c;
+  }
+
+  streamsize xsputn(const char* data, streamsize size) override
+  {
+    if (device_.write(data, (qint64)size) != (qint64)size) {
+      hasError_ = true;
+      return 0;
+    }
+    bytesWritten_ += size;
+    return size;
+  }
+
+private:
+  QIODevice& device_;
+  bool hasError_;
+  qint64 bytesWritten_;
+};
+
+bool readString(istream& stream, string& value)
+{
+  uint32 size;
+  if (!readValue(stream, size))
+    return false;
+  value.resize(size);
+  return size == 0 || !!stream.read(&value[0], size);
+}
+
+}
+
 ReplicodeObjects::ReplicodeObjects()
+: stopWarmUp_(false)
 {
   // Set up progressLines_. Used by getProgressLabelText to make the progress messages clearer.
   progressMessages_.push_back("Preprocessing code (1 of 2)");
@@ -82,7 +294,7 @@ ReplicodeObjects::ReplicodeObjects()
 }
 
 string ReplicodeObjects::init(const string& userClassesFilePath, const string& decompiledFilePath,
-    microseconds basePeriod, QProgressDialog& progress)
+    const string& imageCacheFilePath, microseconds basePeriod, QProgressDialog& progress)
 {
   basePeriod_ = basePeriod;
 
@@ -91,7 +303,8 @@ string ReplicodeObjects::init(const string& userClassesFilePath, const string& d
   ifstream userClassesFile(userClassesFilePath);
   if (!userClassesFile)
     return "Can't open user classes file: " + userClassesFilePath;
-  r_comp::Metadata metadata;
+  // The decompiler uses the metadata in getSourceCode, so keep it in metadata_.
+  r_comp::Metadata& metadata = metadata_;
   Preprocessor preprocessor;
   string error;
   // We won't compile the preprocessed user operators code.
@@ -119,37 +332,84 @@ string ReplicodeObjects::init(const string& userClassesFilePath, const string& d
     if (!testOpen)
       return "Can't open decompiled objects file: " + decompiledFilePath;
   }
-  auto decompiledOut = processDecompiledObjects(decompiledFilePath, objectOids, objectDetailOids);
 
-  // Preprocess and compile the processed decompiler output, using the metadata we got above.
-  istringstream decompiledIn(decompiledOut);
-  ostringstream preprocessedOut;
+  r_comp::Image image;
+  // The label of each object in the image, by index.
+  vector<string> imageObjectNames;
+  // The compiled image depends on the metadata from the user operators and on the decompiled objects.
+  vector<string> imageCacheInputFilePaths;
+  imageCacheInputFilePaths.push_back(userClassesFilePath);
+  imageCacheInputFilePaths.push_back(decompiledFilePath);
+  if (imageCacheFilePath == "" || !readImageCache(
+        imageCacheFilePath, imageCacheInputFilePaths, image, imageObjectNames, objectOids, objectDetailOids)) {
+    // Keep one copy of the code at a time, except while a stage reads its input and writes its
+    // output. Each stage reads the previous stage's string in place through a MemoryStreambuf,
+    // the preprocessor writes directly into preprocessed through a StringStreambuf, and we free
+    // the previous string as soon as it is used.
+    string preprocessed;
+    {
+      string decompiledOut;
+      if (!processDecompiledObjects(decompiledFilePath, decompiledOut, objectOids, objectDetailOids))
+        return "Can't read decompiled objects file: " + decompiledFilePath;
+
+      // Preprocess the processed decompiler output, using the metadata we got above.
+      MemoryStreambuf decompiledBuffer(decompiledOut.data(), decompiledOut.size());
+      istream decompiledIn(&decompiledBuffer);
+      // The preprocessor output is about the same size as its input.
+      preprocessed.reserve(decompiledOut.size());
+      StringStreambuf preprocessedBuffer(preprocessed);
+      // Preprocessor::process takes an ostringstream*, so we can't pass a plain ostream. It only
+      // writes to it with the stream operators, which use the buffer set by basic_ios::rdbuf
+      // instead of the internal one. We check this after process.
+      ostringstream preprocessedOut;
+      preprocessedOut.basic_ios<char>::rdbuf(&preprocessedBuffer);
+
+      progress.setLabelText(getProgressLabelText("Preprocessing code (2 of 2)"));
+      QApplication::processEvents();
+      if (progress.wasCanceled())
+        return "cancel";
+
+      if (!preprocessor.process(
+          &decompiledIn, decompiledFilePath, &preprocessedOut, error, NULL))
+        return error;
+      // If process wrote through ostringstream::rdbuf, the output is in the internal buffer
+      // instead of in preprocessed.
+      if (!preprocessedOut || (preprocessed.empty() && !decompiledOut.empty()) ||
+          !preprocessedOut.str().empty())
+        return "The preprocessor output did not go to the preprocessed string: " + decompiledFilePath;
+
+      // Free the input now. preprocessed already has the output.
+      string().swap(decompiledOut);
+    }
 
-  progress.setLabelText(getProgressLabelText("Preprocessing code (2 of 2)"));
-  QApplication::processEvents();
-  if (progress.wasCanceled())
-    return "cancel";
+    MemoryStreambuf preprocessedBuffer(preprocessed.data(), preprocessed.size());
+    istream preprocessedIn(&preprocessedBuffer);
+    Compiler compiler(true);
 
-  if (!preprocessor.process(
-      &decompiledIn, decompiledFilePath, &preprocessedOut, error, NULL))
-    return error;
+    progress.setLabelText(getProgressLabelText("Compiling code"));
+    QApplication::processEvents();
+    if (progress.wasCanceled())
+      return "cancel";
 
-  istringstream preprocessedIn(preprocessedOut.str());
-  Compiler compiler(true);
-  r_comp::Image image;
+    if (!compiler.compile(&preprocessedIn, &image, &metadata, error, false)) {
+      preprocessedIn.clear();
+      auto iError = min((size_t)preprocessedIn.tellg(), preprocessed.size());
+      auto nBeforeError = min(iError, 50);
+      auto nAfterError = min(preprocessed.size() - iError, 50);
+      string codeBefore = preprocessed.substr(iError - nBeforeError, nBeforeError);
+      string codeAfter = preprocessed.substr(iError, nBeforeError);
+      return codeBefore + "\n<< " + error + "\n" + codeAfter;
+    }
+    string().swap(preprocessed);
 
-  progress.setLabelText(getProgressLabelText("Compiling code"));
-  QApplication::processEvents();
-  if (progress.wasCanceled())
-    return "cancel";
+    for (size_t i = 0; i < image.code_segment_.objects_.size(); ++i)
+      // getObjectName takes a uint16 index. Don't let a larger index wrap to another object.
+      imageObjectNames.push_back(i <= maxImageIndex_ ? compiler.getObjectName((uint16)i) : "");
 
-  if (!compiler.compile(&preprocessedIn, &image, &metadata, error, false)) {
-    auto iError = (size_t)preprocessedIn.tellg();
-    auto nBeforeError = min(iError, 50);
-    auto nAfterError = min(preprocessedIn.str().size() - iError, 50);
-    string codeBefore = preprocessedIn.str().substr(iError - nBeforeError, nBeforeError);
-    string codeAfter = preprocessedIn.str().substr(iError, nBeforeError);
-    return codeBefore + "\n<< " + error + "\n" + codeAfter;
+    if (imageCacheFilePath != "")
+      // Ignore an error. We will compile again next time.
+      writeImageCache(
+        imageCacheFilePath, imageCacheInputFilePaths, image, imageObjectNames, objectOids, objectDetailOids);
   }
 
   // Transfer objects from the compiler image to imageObjects.
@@ -159,10 +419,14 @@ string ReplicodeObjects::init(const string& userClassesFilePath, const string& d
   image.get_objects(&tempMem, imageObjects);
 
   progress.setLabelText(getProgressLabelText("Postprocessing code"));
-  // We update progress for 3 loops of imageObjects.size().
-  progress.setMaximum(imageObjects.size() * 3);
+  // We update progress for 2 loops of imageObjects.size().
+  progress.setMaximum(imageObjects.size() * 2);
   // Set the OIDs and detail OIDs of objects in imageObjects based on the decompiled output.
   // Set up objectLabel_ and labelObject_ based on the object in imageObjects.
+  // Each label is in labelArena_ once, and the tables and imageObjectLabels_ point to it.
+  imageObjectLabels_.assign(imageObjects.size(), (const char*)NULL);
+  objectLabel_.reserve(imageObjects.size());
+  labelObject_.reserve(imageObjects.size());
   for (auto i = 0; i < imageObjects.size(); ++i) {
     if (progress.wasCanceled())
       return "cancel";
@@ -170,10 +434,12 @@ string ReplicodeObjects::init(const string& userClassesFilePath, const string& d
     if (i % 100 == 0)
       QApplication::processEvents();
 
-    string label = compiler.getObjectName(i);
+    string label = (i < imageObjectNames.size() ? imageObjectNames[i] : "");
     if (label != "") {
-      objectLabel_[imageObjects[i]] = label;
-      labelObject_[label] = imageObjects[i];
+      const char* arenaLabel = labelArena_.add(label);
+      imageObjectLabels_[i] = arenaLabel;
+      objectLabel_[imageObjects[i]] = arenaLabel;
+      labelObject_[arenaLabel] = imageObjects[i];
 
       auto oidEntry = objectOids.find(label);
       if (oidEntry != objectOids.end())
@@ -187,12 +453,22 @@ string ReplicodeObjects::init(const string& userClassesFilePath, const string& d
 
   // Transfer imageObjects to objects_, unpacking and processing as needed.
   // Imitate _Mem::load.
+  oidObject_.clear();
+  detailOidObject_.clear();
+  oidObject_.reserve(imageObjects.size());
+  detailOidObject_.reserve(imageObjects.size());
   for (uint32 i = 0; i < imageObjects.size(); ++i) {
     Code* object = imageObjects[i];
     int32 dummyLocation;
     objects_.push_back(object, dummyLocation);
     // We don't need to delete, so don't set the storage index.
 
+    // Index the object for getObject and getObjectByDetailOid. Use emplace so that, as with
+    // a search of objects_, the first object with a given OID is found.
+    if (object->get_oid() != UNDEFINED_OID)
+      oidObject_.emplace(object->get_oid(), object);
+    detailOidObject_.emplace(object->get_detail_oid(), object);
+
     switch (object->code(0).getDescriptor()) {
     case Atom::MODEL:
       _Mem::unpack_hlp(object);
@@ -230,139 +506,398 @@ string ReplicodeObjects::init(const string& userClassesFilePath, const string& d
 
   // We have to get the source code by decompiling the packet objects in objects_ (not from
   // the original decompiled code in decompiledFilePath) because variable names can be different.
-  r_comp::Image packedImage;
-  packedImage.object_names_.symbols_ = image.object_names_.symbols_;
-  packedImage.add_objects(objects_, true);
+  // Keep the packed image and decompiler so that getSourceCode can decompile an object when needed.
+  packedImage_.object_names_.symbols_ = image.object_names_.symbols_;
+  packedImage_.add_objects(objects_, true);
 
-  Decompiler decompiler;
-  decompiler.init(&metadata);
+  referenceDecompiler_.init(&metadata_);
 
-  // Fill the objectNames map from the image and use it in decompile_references.
-  unordered_map<uint16, std::string> objectNames;
-  for (auto i = 0; i < packedImage.code_segment_.objects_.size(); ++i) {
+  for (auto i = 0; i < packedImage_.code_segment_.objects_.size(); ++i) {
     if (progress.wasCanceled())
       return "cancel";
     progress.setValue(imageObjects.size() + i);
     if (i % 100 == 0)
       QApplication::processEvents();
 
-    objectNames[i] = compiler.getObjectName(i);
+    auto object = getObjectByDetailOid(packedImage_.code_segment_.objects_[i]->detail_oid_);
+    if (object)
+      // Keep the full index. getSourceCode checks it against maxImageIndex_.
+      objectImageIndex_[object] = (uint32)i;
   }
-  decompiler.decompile_references(&packedImage, &objectNames);
+  // Make the reference tables once. decompiler_ and each thread of decompileAllSourceCode copy them.
+  auto objectNames = getImageObjectNames();
+  referenceDecompiler_.decompile_references(&packedImage_, &objectNames);
+  decompiler_ = referenceDecompiler_;
 
-  for (uint16 i = 0; i < packedImage.code_segment_.objects_.size(); ++i) {
-    if (progress.wasCanceled())
-      return "cancel";
-    progress.setValue(2 * imageObjects.size() + i);
-    if (i % 100 == 0)
-      QApplication::processEvents();
+  return "";
+}
 
-    auto object = getObjectByDetailOid(packedImage.code_segment_.objects_[i]->detail_oid_);
-    if (object) {
-      std::ostringstream decompiledCode;
-      decompiler.decompile_object(i, &decompiledCode, timeReference_, false, false, false);
-      auto source = decompiledCode.str();
+string ReplicodeObjects::getSourceCode(Code* object) const
+{
+  lock_guard<mutex> lock(sourceCodeMutex_);
+
+  auto result = objectSourceCode_.find(object);
+  if (result != objectSourceCode_.end())
+    return string(result->second);
+
+  auto imageIndex = objectImageIndex_.find(object);
+  if (imageIndex == objectImageIndex_.end())
+    return "";
+  if (imageIndex->second > maxImageIndex_)
+    // Don't let the index wrap, which would decompile another object.
+    return "; Can't decompile: The index " + to_string(imageIndex->second) +
+      " in the packed image is over the decompiler limit of " + to_string(maxImageIndex_) + ".";
+
+  auto source = decompileObject(decompiler_, (uint16)imageIndex->second);
+  objectSourceCode_[object] = sourceCodeArena_.add(source);
+  return source;
+}
 
-      // Strip ending newlines.
-      while (source[source.size() - 1] == '\n')
-        source = source.substr(0, source.size() - 1);
-      objectSourceCode_[object] = source;
+string ReplicodeObjects::decompileObject(Decompiler& decompiler, uint16 imageIndex) const
+{
+  std::ostringstream decompiledCode;
+  decompiler.decompile_object(imageIndex, &decompiledCode, timeReference_, false, false, false);
+  auto source = decompiledCode.str();
+
+  // Strip ending newlines.
+  while (source.size() > 0 && source[source.size() - 1] == '\n')
+    source = source.substr(0, source.size() - 1);
+  return source;
+}
+
+void ReplicodeObjects::decompileAllSourceCode(unsigned int nThreads)
+{
+  decompileAllSourceCode(nThreads, NULL);
+}
+
+void ReplicodeObjects::decompileAllSourceCode(unsigned int nThreads, const atomic<bool>* stop)
+{
+  if (nThreads == 0)
+    nThreads = max(1u, thread::hardware_concurrency());
+
+  // Get the objects in image index order so that each thread decompiles a contiguous range.
+  // Skip an object over maxImageIndex_, for which getSourceCode returns an error message.
+  vector<pair<uint16, Code*> > indexObjects;
+  indexObjects.reserve(objectImageIndex_.size());
+  for (auto entry = objectImageIndex_.begin(); entry != objectImageIndex_.end(); ++entry) {
+    if (entry->second <= maxImageIndex_)
+      indexObjects.push_back(make_pair((uint16)entry->second, entry->first));
+  }
+  sort(indexObjects.begin(), indexObjects.end());
+  nThreads = (unsigned int)max((size_t)1, min((size_t)nThreads, indexObjects.size()));
+
+  vector<vector<pair<Code*, string> > > threadSources(nThreads);
+  vector<thread> threads;
+  for (unsigned int iThread = 0; iThread < nThreads; ++iThread) {
+    threads.push_back(thread([&, iThread]() {
+      size_t begin = indexObjects.size() * iThread / nThreads;
+      size_t end = indexObjects.size() * (iThread + 1) / nThreads;
+
+      // decompile_object changes the decompiler state (the output stream, indents and variable
+      // names), so each thread needs its own. Copy the reference tables from referenceDecompiler_,
+      // which has never called decompile_object, instead of running decompile_references again.
+      // The threads can decompile at the same time because decompile_object only reads
+      // packedImage_ and metadata_, which don't change after init, and getSourceCode also only
+      // reads them through decompiler_.
+      Decompiler decompiler(referenceDecompiler_);
+      for (size_t i = begin; i < end && !(stop && *stop); ++i) {
+        {
+          lock_guard<mutex> lock(sourceCodeMutex_);
+          if (objectSourceCode_.find(indexObjects[i].second) != objectSourceCode_.end())
+            // Already decompiled by getSourceCode.
+            continue;
+        }
+
+        threadSources[iThread].push_back(make_pair(
+          indexObjects[i].second, decompileObject(decompiler, indexObjects[i].first)));
+      }
+    }));
+  }
+  for (size_t i = 0; i < threads.size(); ++i)
+    threads[i].join();
+
+  // Merge the results. Skip a result from a call to getSourceCode in the meantime.
+  lock_guard<mutex> lock(sourceCodeMutex_);
+  for (size_t iThread = 0; iThread < threadSources.size(); ++iThread) {
+    for (auto entry = threadSources[iThread].begin(); entry != threadSources[iThread].end(); ++entry) {
+      if (objectSourceCode_.find(entry->first) == objectSourceCode_.end())
+        objectSourceCode_[entry->first] = sourceCodeArena_.add(entry->second);
     }
+    vector<pair<Code*, string> >().swap(threadSources[iThread]);
   }
+}
 
-  return "";
+unordered_map<uint16, string> ReplicodeObjects::getImageObjectNames() const
+{
+  unordered_map<uint16, string> objectNames;
+  // The key is a uint16, so stop at maxImageIndex_ instead of wrapping to replace a name.
+  for (size_t i = 0; i < packedImage_.code_segment_.objects_.size() && i <= maxImageIndex_; ++i)
+    objectNames[(uint16)i] =
+      (i < imageObjectLabels_.size() && imageObjectLabels_[i] ? imageObjectLabels_[i] : "");
+
+  return objectNames;
+}
+
+ReplicodeObjects::TableStats ReplicodeObjects::getTableStats() const
+{
+  lock_guard<mutex> lock(sourceCodeMutex_);
+
+  TableStats stats;
+  stats.nLabels = objectLabel_.size();
+  stats.nSourceCodes = objectSourceCode_.size();
+  stats.stringBytes = labelArena_.getAllocatedBytes() + sourceCodeArena_.getAllocatedBytes();
+  // A hash table node has the next pointer and the value. Add a pointer for each bucket.
+  stats.tableBytes =
+    objectLabel_.size() * (sizeof(void*) + sizeof(pair<Code*, const char*>)) +
+    objectLabel_.bucket_count() * sizeof(void*) +
+    labelObject_.size() * (sizeof(void*) + sizeof(pair<const char*, Code*>)) +
+    labelObject_.bucket_count() * sizeof(void*) +
+    objectSourceCode_.size() * (sizeof(void*) + sizeof(pair<Code*, const char*>)) +
+    objectSourceCode_.bucket_count() * sizeof(void*) +
+    imageObjectLabels_.capacity() * sizeof(const char*);
+
+  // A std::map node has three pointers and two flags, padded. A std::string allocates
+  // a heap copy when longer than its small buffer.
+  const size_t stdMapNodeBytes = 4 * sizeof(void*);
+  const size_t smallStringSize = 15;
+  auto stdStringBytes = [=](size_t size) {
+    return sizeof(string) + (size > smallStringSize ? size + 1 : 0);
+  };
+  stats.stdMapBytes = 0;
+  for (auto entry = objectLabel_.begin(); entry != objectLabel_.end(); ++entry)
+    // objectLabel_ and labelObject_ each have a node and a std::string copy of the label.
+    stats.stdMapBytes += 2 * (stdMapNodeBytes + sizeof(Code*) + stdStringBytes(strlen(entry->second)));
+  for (auto entry = objectSourceCode_.begin(); entry != objectSourceCode_.end(); ++entry)
+    stats.stdMapBytes += stdMapNodeBytes + sizeof(Code*) + stdStringBytes(strlen(entry->second));
+
+  return stats;
+}
+
+void ReplicodeObjects::startSourceCodeWarmUp()
+{
+  if (warmUpThread_.joinable())
+    return;
+
+  stopWarmUp_ = false;
+  warmUpThread_ = thread([this]() {
+    // Leave a core for the GUI thread.
+    unsigned int nCores = thread::hardware_concurrency();
+    decompileAllSourceCode(nCores > 1 ? nCores - 1 : 1, &stopWarmUp_);
+  });
 }
 
-string ReplicodeObjects::processDecompiledObjects(
-  string decompiledFilePath, map<string, uint32>& objectOids, map<string, uint64>& objectDetailOids)
+ReplicodeObjects::~ReplicodeObjects()
+{
+  stopWarmUp_ = true;
+  if (warmUpThread_.joinable())
+    warmUpThread_.join();
+}
+
+bool ReplicodeObjects::processDecompiledObjects(
+  const string& decompiledFilePath, string& decompiledOut, map<string, uint32>& objectOids,
+  map<string, uint64>& objectDetailOids)
 {
   objectOids.clear();
   objectDetailOids.clear();
-
-  ifstream rawDecompiledFile(decompiledFilePath);
-  regex blankLineRegex("^\\s*$");
-  regex timeReferenceRegex("^> DECOMPILATION. TimeReference (\\d+)s:(\\d+)ms:(\\d+)us");
-  regex detailOidRegex("^\\((\\d+)\\) ([\\w\\.]+)(:)(.+)$");
-  regex oidAndDetailOidRegex("^(\\d+)\\((\\d+)\\) (\\w+)(:)(.+)$");
+  decompiledOut.clear();
+
+  // Map the file into memory and scan the lines in place.
+  QFile rawDecompiledFile(QString::fromStdString(decompiledFilePath));
+  if (!rawDecompiledFile.open(QIODevice::ReadOnly))
+    return false;
+  qint64 fileSize = rawDecompiledFile.size();
+  const char* fileData = "";
+  QByteArray fileContents;
+  if (fileSize > 0) {
+    fileData = (const char*)rawDecompiledFile.map(0, fileSize);
+    if (!fileData) {
+      // We can't map the file, so read it all.
+      fileContents = rawDecompiledFile.readAll();
+      fileData = fileContents.constData();
+      fileSize = fileContents.size();
+    }
+  }
+  const char* fileEnd = fileData + fileSize;
+  // The output is the input minus the OIDs, plus a few newlines.
+  decompiledOut.reserve((size_t)fileSize + fileSize / 64);
 
   // Scan the input and fill decompiledOut.
-  uint64 currentDetailOid = 0;
-  ostringstream decompiledOut;
-  string line;
-  while (getline(rawDecompiledFile, line)) {
-    smatch matches;
-
-    if (regex_search(line, matches, blankLineRegex))
+  const char* lineEnd;
+  for (const char* line = fileData; line < fileEnd; line = lineEnd + 1) {
+    lineEnd = (const char*)memchr(line, '\n', fileEnd - line);
+    if (!lineEnd)
+      lineEnd = fileEnd;
+    // As when reading in text mode, ignore the carriage return of a CRLF line ending.
+    const char* end = (lineEnd > line && lineEnd[-1] == '\r' ? lineEnd - 1 : lineEnd);
+    // Like the regex ".+", the source code on an object's first line can't have a carriage return.
+    bool hasCarriageReturn = (memchr(line, '\r', end - line) != 0);
+
+    const char* p = line;
+    uint64 timeSeconds, timeMilliseconds, timeMicroseconds;
+    uint32 oid;
+    uint64 detailOid;
+    const char* name;
+    const char* nameEnd;
+    if (all_of(line, end, [](char c) { return isspace((unsigned char)c) != 0; }))
       // Skip blank lines.
-      decompiledOut << endl;
-    if (regex_search(line, matches, timeReferenceRegex)) {
-      microseconds us(1000000 * stoll(matches[1].str()) +
-        1000 * stoll(matches[2].str()) +
-        stoll(matches[3].str()));
+      decompiledOut += '\n';
+
+    // Match "> DECOMPILATION. TimeReference 0s:0ms:0us" where '.' is any character except a carriage return.
+    if (parseLiteral(p, end, "> DECOMPILATION") && p < end && *p++ != '\r' &&
+        parseLiteral(p, end, " TimeReference ") &&
+        parseNumber(p, end, timeSeconds) && parseLiteral(p, end, "s:") &&
+        parseNumber(p, end, timeMilliseconds) && parseLiteral(p, end, "ms:") &&
+        parseNumber(p, end, timeMicroseconds) && parseLiteral(p, end, "us")) {
+      microseconds us(1000000 * timeSeconds + 1000 * timeMilliseconds + timeMicroseconds);
       timeReference_ = Timestamp(us);
 
       // Make the line blank.
-      decompiledOut << endl;
+      decompiledOut += '\n';
     }
-    else if (line.size() > 0 && line[0] == '>')
+    else if (line < end && line[0] == '>')
       // Skip other decompiler messages starting with '>'.
-      decompiledOut << endl;
-    else if (regex_search(line, matches, detailOidRegex)) {
-      auto detailOid = stoull(matches[1].str());
-      auto name = matches[2].str();
-      auto sourceCodeStart = matches[4].str();
-      objectOids[name] = UNDEFINED_OID;
-      objectDetailOids[name] = detailOid;
-
-      // Use the line without the OID.
-      decompiledOut << name << ':' << sourceCodeStart << endl;
-
-      // We are starting a new object.
-      currentDetailOid = detailOid;
+      decompiledOut += '\n';
+    else if (!hasCarriageReturn && (parseObjectLine(line, end, false, oid, detailOid, name, nameEnd) ||
+                                    parseObjectLine(line, end, true, oid, detailOid, name, nameEnd))) {
+      string label(name, nameEnd);
+      objectOids[label] = oid;
+      objectDetailOids[label] = detailOid;
+
+      // Use the line without the OID. The label is followed by ':' and the source code.
+      decompiledOut.append(name, end);
+      decompiledOut += '\n';
     }
-    else if (regex_search(line, matches, oidAndDetailOidRegex)) {
-      auto oid = stoul(matches[1].str());
-      auto detailOid = stoul(matches[2].str());
-      auto name = matches[3].str();
-      auto sourceCodeStart = matches[5].str();
-      objectOids[name] = oid;
-      objectDetailOids[name] = detailOid;
-
-      // Use the line without the OID.
-      decompiledOut << name << ':' << sourceCodeStart << endl;
-
-      // We are starting a new object.
-      currentDetailOid = detailOid;
-    }
-    else
+    else {
       // Use the line as-is.
-      decompiledOut << line << endl;
+      decompiledOut.append(line, end);
+      decompiledOut += '\n';
+    }
   }
 
-  return decompiledOut.str();
+  return true;
 }
 
-Code* ReplicodeObjects::getObject(uint32 oid) const
+bool ReplicodeObjects::readImageCache(
+  const string& imageCacheFilePath, const vector<string>& inputFilePaths, r_comp::Image& image,
+  vector<string>& imageObjectNames, map<string, uint32>& objectOids, map<string, uint64>& objectDetailOids)
 {
-  if (oid == UNDEFINED_OID)
-    return NULL;
+  ifstream cacheFile(imageCacheFilePath, ios::binary);
+  if (!cacheFile)
+    return false;
+
+  uint32 magic, formatVersion;
+  if (!readValue(cacheFile, magic) || !readValue(cacheFile, formatVersion) ||
+      magic != IMAGE_CACHE_MAGIC || formatVersion != IMAGE_CACHE_FORMAT_VERSION)
+    return false;
+
+  // Check that the input files are the same as when the cache was written.
+  QByteArray key;
+  string cacheKey;
+  if (!getInputFilesKey(inputFilePaths, key) || !readString(cacheFile, cacheKey) ||
+      cacheKey != string(key.constData(), key.size()))
+    return false;
+
+  int64 timeReferenceUs;
+  if (!readValue(cacheFile, timeReferenceUs))
+    return false;
+
+  uint32 nNames;
+  if (!readValue(cacheFile, nNames))
+    return false;
+  vector<string> newImageObjectNames(nNames);
+  for (uint32 i = 0; i < nNames; ++i) {
+    if (!readString(cacheFile, newImageObjectNames[i]))
+      return false;
+  }
 
-  for (auto o = objects_.begin(); o != objects_.end(); ++o) {
-    if ((*o)->get_oid() == oid)
-      return *o;
+  uint32 nOids;
+  if (!readValue(cacheFile, nOids))
+    return false;
+  map<string, uint32> newObjectOids;
+  map<string, uint64> newObjectDetailOids;
+  for (uint32 i = 0; i < nOids; ++i) {
+    string name;
+    uint32 oid;
+    uint64 detailOid;
+    if (!readString(cacheFile, name) || !readValue(cacheFile, oid) || !readValue(cacheFile, detailOid))
+      return false;
+    newObjectOids[name] = oid;
+    newObjectDetailOids[name] = detailOid;
   }
 
-  return NULL;
+  // The rest of the file is the image as written by r_code::Image::Write.
+  auto serializedImage = r_code::Image<ImageImpl>::Read(cacheFile);
+  if (!serializedImage)
+    return false;
+  if (!cacheFile) {
+    delete serializedImage;
+    return false;
+  }
+  image.load(serializedImage);
+  delete serializedImage;
+
+  timeReference_ = Timestamp(microseconds(timeReferenceUs));
+  imageObjectNames.swap(newImageObjectNames);
+  objectOids.swap(newObjectOids);
+  objectDetailOids.swap(newObjectDetailOids);
+  return true;
 }
 
-Code* ReplicodeObjects::getObjectByDetailOid(uint64 detailOid) const
+bool ReplicodeObjects::writeImageCache(
+  const string& imageCacheFilePath, const vector<string>& inputFilePaths, r_comp::Image& image,
+  const vector<string>& imageObjectNames, const map<string, uint32>& objectOids,
+  const map<string, uint64>& objectDetailOids) const
 {
-  for (auto o = objects_.begin(); o != objects_.end(); ++o) {
-    if ((*o)->get_detail_oid() == detailOid)
-      return *o;
+  QByteArray key;
+  if (!getInputFilesKey(inputFilePaths, key))
+    return false;
+
+  // Use QSaveFile like EventCache::write so that an existing cache file is only replaced
+  // when the new one is complete.
+  QSaveFile saveFile(QString::fromStdString(imageCacheFilePath));
+  if (!saveFile.open(QIODevice::WriteOnly))
+    return false;
+  QIODeviceStreambuf saveFileBuffer(saveFile);
+  ostream cacheFile(&saveFileBuffer);
+
+  writeValue(cacheFile, IMAGE_CACHE_MAGIC);
+  writeValue(cacheFile, IMAGE_CACHE_FORMAT_VERSION);
+  writeString(cacheFile, string(key.constData(), key.size()));
+  writeValue(cacheFile, (int64)duration_cast<microseconds>(timeReference_.time_since_epoch()).count());
+
+  writeValue(cacheFile, (uint32)imageObjectNames.size());
+  for (size_t i = 0; i < imageObjectNames.size(); ++i)
+    writeString(cacheFile, imageObjectNames[i]);
+
+  // processDecompiledObjects sets objectOids and objectDetailOids for the same names.
+  writeValue(cacheFile, (uint32)objectOids.size());
+  for (auto entry = objectOids.begin(); entry != objectOids.end(); ++entry) {
+    auto detailOid = objectDetailOids.find(entry->first);
+    writeString(cacheFile, entry->first);
+    writeValue(cacheFile, entry->second);
+    writeValue(cacheFile, (uint64)(detailOid != objectDetailOids.end() ? detailOid->second : 0));
   }
 
-  return NULL;
+  // r_code::Image::Write takes a std::ofstream&, so give it an ofstream which is never opened
+  // and whose basic_ios buffer is saveFileBuffer. Write only calls ofstream::write, for the
+  // image sizes and then the image data, and write uses the basic_ios buffer. The members
+  // which would use the ofstream's own unopened filebuf are is_open, close and ofstream::rdbuf,
+  // and Write doesn't call them. (If it did, is_open would be false, close would set failbit,
+  // and a write through ofstream::rdbuf would not reach saveFileBuffer. We check for these
+  // below, and don't commit the file.)
+  ofstream imageStream;
+  imageStream.basic_ios<char>::rdbuf(&saveFileBuffer);
+  auto serializedImage = image.serialize<r_code::Image<ImageImpl> >();
+  qint64 imageStart = saveFileBuffer.bytesWritten();
+  r_code::Image<ImageImpl>::Write(serializedImage, imageStream);
+  delete serializedImage;
+
+  // The image always has its sizes, so check that Write wrote something to saveFileBuffer.
+  if (!cacheFile || !imageStream || saveFileBuffer.hasError() || saveFileBuffer.bytesWritten() == imageStart) {
+    saveFile.cancelWriting();
+    return false;
+  }
+  return saveFile.commit();
 }
 
 QString ReplicodeObjects::getProgressLabelText(const QString& message)
@@ -55,10 +55,18 @@
 #define REPLICODE_OBJECTS_HPP
 
 #include <string>
+#include <vector>
 #include <map>
+#include <unordered_map>
+#include <mutex>
+#include <thread>
+#include <atomic>
 #include <regex>
 #include <QString>
 #include "submodules/AERA/r_exec/mem.h"
+#include "submodules/AERA/r_comp/segments.h"
+#include "submodules/AERA/r_comp/decompiler.h"
+#include "string-arena.hpp"
 
 class QProgressDialog;
 
@@ -72,6 +80,8 @@ class ReplicodeObjects {
 public:
   ReplicodeObjects();
 
+  ~ReplicodeObjects();
+
   /**
    * Compile and load the metadata from the user operators file, then compile
    * the decompiled file and set up the list of Replicode objects. This
@@ -80,6 +90,9 @@ public:
    * in "user.classes.replicode".
    * \param decompiledFilePath The decompiled output, usually ending in
    * "decompiled_objects.txt".
+   * \param imageCacheFilePath The path of a cache file for the compiled image. If the cache file was
+   * written for the same user operators and decompiled files, then use it to skip processing and compiling
+   * the decompiled file. Otherwise, compile and write the cache file. If "", don't use a cache file.
    * \param basePeriod The base_period from settings.xml, used for getSamplinePeriod().
    * \param progress The progress dialog where you can call setLabelText, setMaximum and setValue. You should
    * periodically call QApplication::processEvents(). You can call wasCanceled and quit if true.
@@ -87,7 +100,7 @@ public:
    * the user clicked Cancel in the progress dialog.
    */
   std::string init(const std::string& userClassesFilePath, const std::string& decompiledFilePath,
-    std::chrono::microseconds basePeriod, QProgressDialog& progress);
+    const std::string& imageCacheFilePath, std::chrono::microseconds basePeriod, QProgressDialog& progress);
 
   /**
    * Get the sampling period, which is 2 * base_period from settings.xml. This should
@@ -103,18 +116,33 @@ public:
   core::Timestamp getTimeReference() const { return timeReference_; }
 
   /**
-   * Get the object by the OID.
+   * Get the object by the OID. This uses the index built by init().
    * \param oid The OID.
    * \return The object, or NULL if not found.
    */
-  r_code::Code* getObject(uint32 oid) const;
+  r_code::Code* getObject(uint32 oid) const
+  {
+    if (oid == UNDEFINED_OID)
+      return NULL;
+
+    auto result = oidObject_.find(oid);
+    if (result == oidObject_.end())
+      return NULL;
+    return result->second;
+  }
 
   /**
-   * Get the object by the detail OID.
+   * Get the object by the detail OID. This uses the index built by init().
    * \param detailOid The detail OID.
    * \return The object, or NULL if not found.
    */
-  r_code::Code* getObjectByDetailOid(uint64 detailOid) const;
+  r_code::Code* getObjectByDetailOid(uint64 detailOid) const
+  {
+    auto result = detailOidObject_.find(detailOid);
+    if (result == detailOidObject_.end())
+      return NULL;
+    return result->second;
+  }
 
   /**
    * Get the object's label (from the decompiled objects file).
@@ -126,7 +154,7 @@ public:
     auto result = objectLabel_.find(object);
     if (result == objectLabel_.end())
       return "";
-    return result->second;
+    return std::string(result->second);
   }
 
   /**
@@ -136,25 +164,77 @@ public:
    */
   r_code::Code* getObject(const std::string& label) const
   {
-    auto result = labelObject_.find(label);
+    auto result = labelObject_.find(label.c_str());
     if (result == labelObject_.end())
       return NULL;
     return result->second;
   }
 
   /**
-   * Get the object source code (from the decompiled objects file).
-   * \param object The object.
-   * \return The source code, or "" if not found. This does not have the label or view set.
+   * Get the object by its label (from the decompiled objects file). This is the same as
+   * getObject(const std::string&), but you can call it with a string literal such as
+   * "essence" without making a temporary std::string.
+   * \param label The null-terminated label.
+   * \return The object, or NULL if not found.
    */
-  std::string getSourceCode(r_code::Code* object) const
+  r_code::Code* getObject(const char* label) const
   {
-    auto result = objectSourceCode_.find(object);
-    if (result == objectSourceCode_.end())
-      return "";
+    auto result = labelObject_.find(label);
+    if (result == labelObject_.end())
+      return NULL;
     return result->second;
   }
 
+  /**
+   * Get the object source code (from the decompiled objects file). The first call for an object
+   * decompiles it and later calls return the saved result. This is thread safe.
+   * \param object The object.
+   * \return The source code, or "" if not found. This does not have the label or view set. If the
+   * object's index in the packed image is over maxImageIndex_, return a Replicode comment with an
+   * error message since the decompiler can't decompile it.
+   */
+  std::string getSourceCode(r_code::Code* object) const;
+
+  /**
+   * Decompile the source code of all objects which getSourceCode has not already decompiled, so
+   * that later calls to getSourceCode return immediately. This splits the objects into ranges of the
+   * packed image and decompiles each range in a thread with its own decompiler. Call this after init.
+   * This returns when finished. It is thread safe with getSourceCode.
+   * \param nThreads The number of threads. If 0, use the number of hardware threads.
+   */
+  void decompileAllSourceCode(unsigned int nThreads = 0);
+
+  /**
+   * Start a background thread which calls decompileAllSourceCode. This is optional. Call this
+   * after init. If the thread is already started, do nothing. The destructor stops the thread.
+   */
+  void startSourceCodeWarmUp();
+
+  /**
+   * TableStats has the sizes of the label and source code tables, from getTableStats().
+   */
+  struct TableStats {
+    // The number of objects with a label.
+    size_t nLabels;
+    // The number of objects whose source code has been decompiled.
+    size_t nSourceCodes;
+    // The bytes allocated for the label and source code strings.
+    size_t stringBytes;
+    // The estimated bytes of the hash tables which point to the strings.
+    size_t tableBytes;
+    // The estimated bytes for the same contents in std::map tables with a std::string for each
+    // entry, and a second copy of each label for the reverse lookup.
+    size_t stdMapBytes;
+  };
+
+  /**
+   * Get the sizes of the label and source code tables, and an estimate of the size of the same
+   * contents in std::map tables. The memory saved is stdMapBytes - (stringBytes + tableBytes).
+   * This is thread safe with getSourceCode.
+   * \return The TableStats.
+   */
+  TableStats getTableStats() const;
+
   /**
    * Similar to r_code::Utils::RelativeTime, use Time::ToString_seconds to show the
    * relative time from the time reference (but use getTimeReference() from this object, not
@@ -178,27 +258,102 @@ public:
 private:
   /**
    * Process the decompiled objects file to remove OIDs, detail OIDs and info lines starting with ">".
-   * This sets timeReference_ from the header info line. This gets the object's source code, which is
-   * stripped of the label and view set.
-   * The source code does not have an ending newline, even if it is multi-line code.
+   * This sets timeReference_ from the header info line. This maps the file and scans each line in place.
    * \param decompiledFilePath The path of the decompiled objects file.
+   * \param decompiledOut Set this to the decompiled objects file with removed OIDs and detail OIDs.
    * \param objectOids Fill this map of label to OID. This first clears the map.
    * \param objectDetailOids Fill this map of label to detail OID. This first clears the map.
-   * \return A string of the decompiled objects file with removed OIDs and detail OIDs.
+   * \return True for success, false if the file can't be read.
+   */
+  bool processDecompiledObjects(
+    const std::string& decompiledFilePath, std::string& decompiledOut,
+    std::map<std::string, core::uint32>& objectOids, std::map<std::string, core::uint64>& objectDetailOids);
+
+  /**
+   * Read the compiled image cache file written by writeImageCache.
+   * \param imageCacheFilePath The path of the cache file.
+   * \param inputFilePaths The paths of the user operators and decompiled files.
+   * \param image Load the compiled image into this.
+   * \param imageObjectNames Set this to the label of each object in the image, by index.
+   * \param objectOids Set this map of label to OID, as from processDecompiledObjects.
+   * \param objectDetailOids Set this map of label to detail OID, as from processDecompiledObjects.
+   * \return True for success. This also sets timeReference_. Return false if the cache file doesn't
+   * exist or an input file has changed, in which case nothing is changed.
    */
-  std::string processDecompiledObjects(
-    std::string decompiledFilePath, std::map<std::string, core::uint32>& objectOids,
+  bool readImageCache(
+    const std::string& imageCacheFilePath, const std::vector<std::string>& inputFilePaths, r_comp::Image& image,
+    std::vector<std::string>& imageObjectNames, std::map<std::string, core::uint32>& objectOids,
     std::map<std::string, core::uint64>& objectDetailOids);
 
+  /**
+   * Write the compiled image, the values from processDecompiledObjects and timeReference_ to the
+   * cache file, keyed by the input files. An existing cache file is only replaced when the new one
+   * is complete.
+   * \return True for success, false if the file can't be written.
+   */
+  bool writeImageCache(
+    const std::string& imageCacheFilePath, const std::vector<std::string>& inputFilePaths, r_comp::Image& image,
+    const std::vector<std::string>& imageObjectNames, const std::map<std::string, core::uint32>& objectOids,
+    const std::map<std::string, core::uint64>& objectDetailOids) const;
+
+  /**
+   * Use the decompiler to decompile the object in packedImage_.
+   * \param decompiler The decompiler, initialized with metadata_ and packedImage_.
+   * \param imageIndex The object's index in packedImage_.
+   * \return The source code, without ending newlines.
+   */
+  std::string decompileObject(r_comp::Decompiler& decompiler, uint16 imageIndex) const;
+
+  /**
+   * Decompile the source code of all objects, as in the public decompileAllSourceCode.
+   * \param nThreads The number of threads. If 0, use the number of hardware threads.
+   * \param stop If not NULL, stop early when *stop becomes true, which leaves some objects to be
+   * decompiled by getSourceCode. The warm-up thread passes &stopWarmUp_. If NULL, decompile all.
+   */
+  void decompileAllSourceCode(unsigned int nThreads, const std::atomic<bool>* stop);
+
+  /**
+   * Get the map of object labels to use in decompile_references.
+   * \return The map where the key is the index in packedImage_ and the value is the label.
+   */
+  std::unordered_map<uint16, std::string> getImageObjectNames() const;
+
   std::chrono::microseconds basePeriod_;
   core::Timestamp timeReference_;
-  // Key is the Code* object, value is the source code from the decompiled objects.
-  std::map<r_code::Code*, std::string> objectSourceCode_;
-  // Key is the Code* object, value is the label from the decompiled objects.
-  std::map<r_code::Code*, std::string> objectLabel_;
-  // Key is the label from the decompiled objects, value is the Code* object.
-  std::map<std::string, r_code::Code*> labelObject_;
+  r_comp::Metadata metadata_;
+  // The packed image of objects_, used by decompiler_ in getSourceCode.
+  r_comp::Image packedImage_;
+  // The decompiler after decompile_references, which is never used to decompile an object.
+  // decompiler_ and each thread of decompileAllSourceCode are a copy of it. (A decompiler which
+  // has decompiled an object owns its output stream, so it should not be copied.)
+  r_comp::Decompiler referenceDecompiler_;
+  // decompile_object changes the decompiler state, so it is mutable and used with sourceCodeMutex_.
+  mutable r_comp::Decompiler decompiler_;
+  // The labels and source code are in arenas. The tables below point into them.
+  StringArena labelArena_;
+  mutable StringArena sourceCodeArena_;
+  // The label in labelArena_ of each object in packedImage_ by index, or NULL if none.
+  std::vector<const char*> imageObjectLabels_;
+  // Decompiler::decompile_object and Compiler::getObjectName take a uint16 index, so an object
+  // with a larger index in the image can't be decompiled.
+  static const uint32 maxImageIndex_ = 0xFFFF;
+  // Key is the Code* object, value is its index in packedImage_, which may be over maxImageIndex_.
+  std::unordered_map<r_code::Code*, uint32> objectImageIndex_;
+  // Key is the Code* object, value is the source code in sourceCodeArena_ decompiled by getSourceCode.
+  mutable std::unordered_map<r_code::Code*, const char*> objectSourceCode_;
+  mutable std::mutex sourceCodeMutex_;
+  std::thread warmUpThread_;
+  std::atomic<bool> stopWarmUp_;
+  // Key is the Code* object, value is the label in labelArena_ from the decompiled objects.
+  std::unordered_map<r_code::Code*, const char*> objectLabel_;
+  // Key is the label in labelArena_, value is the Code* object. This hashes and compares the
+  // label string, so find(const char*) does not need a temporary std::string.
+  std::unordered_map<const char*, r_code::Code*, StringArena::Hash, StringArena::Equal> labelObject_;
   r_code::list<P<r_code::Code> > objects_;
+  // Key is the OID, value is the first object in objects_ with that OID.
+  std::unordered_map<uint32, r_code::Code*> oidObject_;
+  // Key is the detail OID, value is the first object in objects_ with that detail OID.
+  std::unordered_map<uint64, r_code::Code*> detailOidObject_;
   std::vector<QString> progressMessages_;
 };
 
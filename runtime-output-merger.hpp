@@ -0,0 +1,212 @@
+//_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/
+//_/_/
+//_/_/ AERA Visualizer
+//_/_/ 
+//_/_/ Copyright (c) 2018-2022 Jeff Thompson
+//_/_/ Copyright (c) 2018-2022 Kristinn R. Thorisson
+//_/_/ Copyright (c) 2018-2022 Icelandic Institute for Intelligent Machines
+//_/_/ http://www.iiim.is
+//_/_/
+//_/_/ --- Open-Source BSD License, with CADIA Clause v 1.0 ---
+//_/_/
+//_/_/ Redistribution and use in source and binary forms, with or without
+//_/_/ modification, is permitted provided that the following conditions
+//_/_/ are met:
+//_/_/ - Redistributions of source code must retain the above copyright
+//_/_/   and collaboration notice, this list of conditions and the
+//_/_/   following disclaimer.
+//_/_/ - Redistributions in binary form must reproduce the above copyright
+//_/_/   notice, this list of conditions and the following disclaimer 
+//_/_/   in the documentation and/or other materials provided with 
+//_/_/   the distribution.
+//_/_/
+//_/_/ - Neither the name of its copyright holders nor the names of its
+//_/_/   contributors may be used to endorse or promote products
+//_/_/   derived from this software without specific prior 
+//_/_/   written permission.
+//_/_/   
+//_/_/ - CADIA Clause: The license granted in and to the software 
+//_/_/   under this agreement is a limited-use license. 
+//_/_/   The software may not be used in furtherance of:
+//_/_/    (i)   intentionally causing bodily injury or severe emotional 
+//_/_/          distress to any person;
+//_/_/    (ii)  invading the personal privacy or violating the human 
+//_/_/          rights of any person; or
+//_/_/    (iii) committing or preparing for any act of war.
+//_/_/
+//_/_/ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND 
+//_/_/ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+//_/_/ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF 
+//_/_/ MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+//_/_/ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR 
+//_/_/ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+//_/_/ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, 
+//_/_/ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+//_/_/ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+//_/_/ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+//_/_/ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+//_/_/ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+//_/_/ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY 
+//_/_/ OF SUCH DAMAGE.
+//_/_/ 
+//_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/
+
+#ifndef RUNTIME_OUTPUT_MERGER_HPP
+#define RUNTIME_OUTPUT_MERGER_HPP
+
+#include <cstring>
+#include <map>
+#include <memory>
+#include <vector>
+#include <atomic>
+#include "runtime-output-parser.hpp"
+
+namespace aera_visualizer {
+
+/**
+ * A RuntimeOutputEntry is made by parseRuntimeOutputChunk for each line of the runtime output
+ * with an event. RuntimeOutputMerger merges the entries of all chunks in order.
+ * \tparam Event The event class, such as AeraEvent.
+ */
+template<class Event> class RuntimeOutputEntry {
+public:
+  typedef decltype(Event::time_) Timestamp;
+
+  RuntimeOutputEntry(
+    RuntimeOutputLine::Type type, bool hasFlushTime, Timestamp flushTime, std::unique_ptr<Event> event)
+  : type_(type), hasFlushTime_(hasFlushTime), flushTime_(flushTime), event_(std::move(event))
+  {}
+
+  RuntimeOutputLine::Type type_;
+  // If hasFlushTime_, then move pending events up to flushTime_ into the events before adding event_.
+  // This is the maximum time of the lines with a timestamp since the previous entry.
+  bool hasFlushTime_;
+  Timestamp flushTime_;
+  // The event, or null if this entry only has the flush time.
+  std::unique_ptr<Event> event_;
+};
+
+/**
+ * Parse the lines of the runtime output from begin to end, and add a RuntimeOutputEntry
+ * for each event to entries. This only reads the lines and calls newEvent, so the caller can
+ * call it from multiple threads for different chunks.
+ * \param begin A pointer to the first line of the chunk.
+ * \param end A pointer to the end of the chunk.
+ * \param timeReference The time reference to add to the time of each line.
+ * \param newEvent A function newEvent(const RuntimeOutputLine& line) which returns the
+ * std::unique_ptr<Event> for the line, or null if the line has no event.
+ * \param entries Add entries to this list.
+ * \param bytesParsed Periodically set this to the number of bytes parsed so far.
+ * \param canceled If this becomes true, return early.
+ */
+template<class Event, class NewEvent> void parseRuntimeOutputChunk(
+  const char* begin, const char* end, typename RuntimeOutputEntry<Event>::Timestamp timeReference,
+  NewEvent newEvent, std::vector<RuntimeOutputEntry<Event> >& entries, std::atomic<int64>& bytesParsed,
+  const std::atomic<bool>& canceled)
+{
+  // A timestamped line flushes the pending events up to its time. We only need to
+  // remember the maximum time of the lines since the previous entry.
+  bool hasFlushTime = false;
+  typename RuntimeOutputEntry<Event>::Timestamp flushTime;
+  int lineNumber = 0;
+  // Reuse the parsed line to avoid allocating its input list for each line.
+  RuntimeOutputLine line;
+  const char* nextLine;
+  for (const char* lineBegin = begin; lineBegin < end; lineBegin = nextLine) {
+    // As with getline, the last line may not end in a newline.
+    const char* lineEnd = (const char*)memchr(lineBegin, '\n', end - lineBegin);
+    if (!lineEnd)
+      lineEnd = end;
+    nextLine = lineEnd + 1;
+
+    ++lineNumber;
+    if (lineNumber % 1000 == 0) {
+      if (canceled)
+        return;
+      bytesParsed = lineBegin - begin;
+    }
+
+    RuntimeOutputParser::parse(lineBegin, lineEnd, line);
+    if (line.hasTimestamp_) {
+      auto timestamp = timeReference + line.time_;
+      if (!hasFlushTime || timestamp > flushTime)
+        flushTime = timestamp;
+      hasFlushTime = true;
+    }
+
+    std::unique_ptr<Event> event = newEvent(line);
+    if (event) {
+      entries.push_back(RuntimeOutputEntry<Event>(line.type_, hasFlushTime, flushTime, std::move(event)));
+      hasFlushTime = false;
+    }
+  }
+
+  if (hasFlushTime)
+    // Flush for the timestamped lines after the last event.
+    entries.push_back(RuntimeOutputEntry<Event>(RuntimeOutputLine::NONE, true, flushTime, std::unique_ptr<Event>()));
+  bytesParsed = end - begin;
+}
+
+/**
+ * RuntimeOutputMerger takes the entries of each chunk in order and gives their events in the
+ * order of the runtime output, except that the event of a MODEL_SIMULATED_PREDICTION_START
+ * line is held until a line with a time at or after its injection time.
+ * \tparam Event The event class, such as AeraEvent.
+ */
+template<class Event> class RuntimeOutputMerger {
+public:
+  /**
+   * Merge the entry.
+   * \param entry The entry. This moves its event.
+   * \param addStartupEvent A function addStartupEvent(RuntimeOutputLine::Type type, std::unique_ptr<Event> event)
+   * which is called for the event of a LOAD_MODEL or LOAD_COMPOSITE_STATE line.
+   * \param addEvent A function addEvent(std::unique_ptr<Event> event) which is called for each
+   * of the other events in order, including pending events which this entry flushes.
+   */
+  template<class AddStartupEvent, class AddEvent> void add(
+    RuntimeOutputEntry<Event>& entry, AddStartupEvent addStartupEvent, AddEvent addEvent)
+  {
+    if (entry.hasFlushTime_) {
+      while (pendingEvents_.size() >= 1 && pendingEvents_.begin()->first <= entry.flushTime_) {
+        // Insert the pending event before this new event.
+        for (size_t i = 0; i < pendingEvents_.begin()->second.size(); ++i)
+          addEvent(std::move(pendingEvents_.begin()->second[i]));
+        pendingEvents_.erase(pendingEvents_.begin());
+      }
+    }
+
+    if (!entry.event_)
+      return;
+
+    if (entry.type_ == RuntimeOutputLine::LOAD_MODEL || entry.type_ == RuntimeOutputLine::LOAD_COMPOSITE_STATE)
+      addStartupEvent(entry.type_, std::move(entry.event_));
+    else if (entry.type_ == RuntimeOutputLine::MODEL_SIMULATED_PREDICTION_START) {
+      // Put in pendingEvents_ to be added later.
+      auto time = entry.event_->time_;
+      pendingEvents_[time].push_back(std::move(entry.event_));
+    }
+    else
+      addEvent(std::move(entry.event_));
+  }
+
+  /**
+   * Call addEvent for the remaining pending events, after the last entry.
+   * \param addEvent The function addEvent(std::unique_ptr<Event> event) as given to add().
+   */
+  template<class AddEvent> void finish(AddEvent addEvent)
+  {
+    for (auto event = pendingEvents_.begin(); event != pendingEvents_.end(); ++event) {
+      for (size_t i = 0; i < event->second.size(); ++i)
+        addEvent(std::move(event->second[i]));
+    }
+    pendingEvents_.clear();
+  }
+
+private:
+  // pendingEvents_ is an ordered map keyed by event time. The value is a list of pending events at the time.
+  std::map<typename RuntimeOutputEntry<Event>::Timestamp, std::vector<std::unique_ptr<Event> > > pendingEvents_;
+};
+
+}
+
+#endif
@@ -0,0 +1,547 @@
+//_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/
+//_/_/
+//_/_/ AERA Visualizer
+//_/_/ 
+//_/_/ Copyright (c) 2018-2022 Jeff Thompson
+//_/_/ Copyright (c) 2018-2022 Kristinn R. Thorisson
+//_/_/ Copyright (c) 2018-2022 Icelandic Institute for Intelligent Machines
+//_/_/ http://www.iiim.is
+//_/_/
+//_/_/ --- Open-Source BSD License, with CADIA Clause v 1.0 ---
+//_/_/
+//_/_/ Redistribution and use in source and binary forms, with or without
+//_/_/ modification, is permitted provided that the following conditions
+//_/_/ are met:
+//_/_/ - Redistributions of source code must retain the above copyright
+//_/_/   and collaboration notice, this list of conditions and the
+//_/_/   following disclaimer.
+//_/_/ - Redistributions in binary form must reproduce the above copyright
+//_/_/   notice, this list of conditions and the following disclaimer 
+//_/_/   in the documentation and/or other materials provided with 
+//_/_/   the distribution.
+//_/_/
+//_/_/ - Neither the name of its copyright holders nor the names of its
+//_/_/   contributors may be used to endorse or promote products
+//_/_/   derived from this software without specific prior 
+//_/_/   written permission.
+//_/_/   
+//_/_/ - CADIA Clause: The license granted in and to the software 
+//_/_/   under this agreement is a limited-use license. 
+//_/_/   The software may not be used in furtherance of:
+//_/_/    (i)   intentionally causing bodily injury or severe emotional 
+//_/_/          distress to any person;
+//_/_/    (ii)  invading the personal privacy or violating the human 
+//_/_/          rights of any person; or
+//_/_/    (iii) committing or preparing for any act of war.
+//_/_/
+//_/_/ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND 
+//_/_/ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+//_/_/ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF 
+//_/_/ MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+//_/_/ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR 
+//_/_/ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+//_/_/ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, 
+//_/_/ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+//_/_/ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+//_/_/ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+//_/_/ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+//_/_/ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+//_/_/ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY 
+//_/_/ OF SUCH DAMAGE.
+//_/_/ 
+//_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/
+
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <limits>
+#include "runtime-output-parser.hpp"
+
+using namespace std;
+using namespace std::chrono;
+
+namespace aera_visualizer {
+
+namespace {
+
+// The original code converted the numbers with stoul, stoll or stol, which throw an exception
+// if the number is out of range. So that such a line still has no event, the scanner rejects it.
+const uint64 OID_MAXIMUM = numeric_limits<unsigned long>::max();
+const uint64 CONTROLLER_OID_MAXIMUM = numeric_limits<long long>::max();
+const uint64 EVIDENCE_COUNT_MAXIMUM = numeric_limits<long>::max();
+const uint64 TIME_MAXIMUM = numeric_limits<long long>::max();
+
+/**
+ * A Scanner holds a position in the line and has methods to consume expected text.
+ * Each method returns false if the text at the position does not match, in which
+ * case the position is undefined and the caller should give up on the pattern.
+ */
+class Scanner {
+public:
+  Scanner(const char* begin, const char* end)
+  : p_(begin), end_(end)
+  {}
+
+  bool atEnd() const { return p_ == end_; }
+
+  const char* position() const { return p_; }
+
+  char peek() const { return p_ < end_ ? *p_ : 0; }
+
+  /**
+   * Consume the literal text.
+   * \param text The null-terminated text to match.
+   * \return True if the text matched.
+   */
+  bool literal(const char* text)
+  {
+    const char* p = p_;
+    for (; *text; ++text, ++p) {
+      if (p >= end_ || *p != *text)
+        return false;
+    }
+
+    p_ = p;
+    return true;
+  }
+
+  /**
+   * Consume one character other than a line terminator, like the regex . (dot).
+   * \return True for success.
+   */
+  bool anyCharacter()
+  {
+    if (!(p_ < end_ && *p_ != '\r' && *p_ != '\n'))
+      return false;
+
+    ++p_;
+    return true;
+  }
+
+  /**
+   * Consume one or more decimal digits, like the regex \d+ .
+   * \param value Set this to the value of the digits, modulo 2^64.
+   * \param maximum The maximum value for isInRange.
+   * \param isInRange Set this true if the value is not greater than maximum.
+   * \return True if there was at least one digit.
+   */
+  bool number(uint64& value, uint64 maximum, bool& isInRange)
+  {
+    if (!(p_ < end_ && isDigit(*p_)))
+      return false;
+
+    value = 0;
+    isInRange = true;
+    for (; p_ < end_ && isDigit(*p_); ++p_) {
+      uint64 digit = *p_ - '0';
+      if (value > (maximum - digit) / 10)
+        isInRange = false;
+      value = 10 * value + digit;
+    }
+    return true;
+  }
+
+  /**
+   * Consume one or more decimal digits, like the regex \d+ , for a number which the original
+   * code converted.
+   * \param value Set this to the value of the digits.
+   * \param maximum The maximum value, such as OID_MAXIMUM.
+   * \return True if there was at least one digit and the value is not greater than maximum.
+   */
+  bool number(uint64& value, uint64 maximum = OID_MAXIMUM)
+  {
+    bool isInRange;
+    return number(value, maximum, isInRange) && isInRange;
+  }
+
+  /**
+   * Consume one or more decimal digits, like the regex \d+ , for a number which the original
+   * code did not convert, so that any number of digits is accepted.
+   * \param value Set this to the value of the digits, modulo 2^64.
+   * \return True if there was at least one digit.
+   */
+  bool digits(uint64& value)
+  {
+    bool isInRange;
+    return number(value, numeric_limits<uint64>::max(), isInRange);
+  }
+
+  /**
+   * Consume one or more decimal digits or '.', like the regex [\d\.]+ , and convert to
+   * float in the same way as stof.
+   * \param value Set this to the float value.
+   * \return True for success, or false where stof would throw an exception.
+   */
+  bool floatNumber(core::float32& value)
+  {
+    const char* start = p_;
+    while (p_ < end_ && (isDigit(*p_) || *p_ == '.'))
+      ++p_;
+    if (p_ == start)
+      return false;
+
+    // strtof needs a null-terminated string. Only use a std::string for a long number.
+    char buffer[32];
+    string longBuffer;
+    const char* floatString = buffer;
+    size_t length = p_ - start;
+    if (length < sizeof(buffer)) {
+      for (size_t i = 0; i < length; ++i)
+        buffer[i] = start[i];
+      buffer[length] = 0;
+    }
+    else {
+      longBuffer.assign(start, p_);
+      floatString = longBuffer.c_str();
+    }
+
+    char* floatEnd;
+    errno = 0;
+    value = strtof(floatString, &floatEnd);
+    // Like stof, fail if there is no number or if it is out of range.
+    return floatEnd != floatString && errno != ERANGE;
+  }
+
+  /**
+   * Consume a time like 0s:200ms:0us .
+   * \param time Set this to the time.
+   * \return True for success.
+   */
+  bool time(microseconds& time)
+  {
+    uint64 s, ms, us;
+    if (!(number(s, TIME_MAXIMUM) && literal("s:") && number(ms, TIME_MAXIMUM) && literal("ms:") &&
+          number(us, TIME_MAXIMUM) && literal("us")))
+      return false;
+
+    time = microseconds(1000000 * s + 1000 * ms + us);
+    return true;
+  }
+
+  /**
+   * Consume one or more word characters, like the regex \w+ .
+   * \param word Set this to the word.
+   * \return True if there was at least one word character.
+   */
+  bool word(string& word)
+  {
+    const char* start = p_;
+    while (p_ < end_ && isWordCharacter(*p_))
+      ++p_;
+    if (p_ == start)
+      return false;
+
+    word.assign(start, p_);
+    return true;
+  }
+
+  /**
+   * Consume an input list like "[ 50 55]" where the contents match the regex [ \d]+ .
+   * As with the original regex, an OID is only used if it follows a space.
+   * \param inputs Append the OIDs to inputs.
+   * \return True for success.
+   */
+  bool inputList(vector<uint64>& inputs)
+  {
+    if (!literal("["))
+      return false;
+
+    const char* start = p_;
+    while (p_ < end_ && (isDigit(*p_) || *p_ == ' ')) {
+      if (*p_ == ' ' && p_ + 1 < end_ && isDigit(p_[1])) {
+        ++p_;
+        uint64 oid;
+        if (!number(oid))
+          return false;
+        inputs.push_back(oid);
+      }
+      else
+        ++p_;
+    }
+    if (p_ == start)
+      return false;
+
+    return literal("]");
+  }
+
+private:
+  static bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+  static bool isWordCharacter(char c)
+  {
+    return isDigit(c) || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+  }
+
+  const char* p_;
+  const char* end_;
+};
+
+}
+
+void RuntimeOutputParser::parse(const char* begin, const char* end, RuntimeOutputLine& line)
+{
+  line.type_ = RuntimeOutputLine::NONE;
+  line.hasTimestamp_ = false;
+  if (end > begin && end[-1] == '\r')
+    // Ignore the carriage return as in a text mode stream.
+    --end;
+
+  Scanner scanner(begin, end);
+  if (scanner.peek() == 'l') {
+    if (scanner.literal("load mdl ")) {
+      if (scanner.number(line.id_[0]) && scanner.literal(", MDLController(") &&
+          scanner.number(line.id_[1], CONTROLLER_OID_MAXIMUM) && scanner.literal(") strength:") &&
+          scanner.floatNumber(line.strength_) && scanner.literal(" cnt:")) {
+        uint64 evidenceCount;
+        if (scanner.number(evidenceCount, EVIDENCE_COUNT_MAXIMUM) && scanner.literal(" sr:") &&
+            scanner.floatNumber(line.successRate_) && scanner.atEnd()) {
+          line.evidenceCount_ = (core::float32)evidenceCount;
+          line.type_ = RuntimeOutputLine::LOAD_MODEL;
+        }
+      }
+    }
+    else if (scanner.literal("load cst ")) {
+      if (scanner.number(line.id_[0]) && scanner.literal(", CSTController(") &&
+          scanner.number(line.id_[1], CONTROLLER_OID_MAXIMUM) && scanner.literal(")") && scanner.atEnd())
+        line.type_ = RuntimeOutputLine::LOAD_COMPOSITE_STATE;
+    }
+
+    return;
+  }
+
+  // The remaining lines all start with a timestamp, followed by a space and at least one character.
+  // As with the regex (.+), the rest of the line can't have another carriage return.
+  if (!(scanner.time(line.time_) && scanner.literal(" ")) || scanner.atEnd() ||
+      memchr(scanner.position(), '\r', end - scanner.position()))
+    return;
+  line.hasTimestamp_ = true;
+
+  parseAfterTimestamp(scanner.position(), end, line);
+}
+
+void RuntimeOutputParser::parseAfterTimestamp(const char* begin, const char* end, RuntimeOutputLine& line)
+{
+  typedef RuntimeOutputLine L;
+  Scanner s(begin, end);
+  uint64* id = line.id_;
+
+  switch (s.peek()) {
+  case '-':
+    if (s.literal("-> mdl ")) {
+      if (s.number(id[0]) && s.literal(", MDLController(") && s.number(id[1], CONTROLLER_OID_MAXIMUM) &&
+          s.literal(")") && s.atEnd())
+        line.type_ = L::NEW_MODEL;
+    }
+    else if (s.literal("-> cst ")) {
+      if (s.number(id[0]) && s.literal(", CSTController(") && s.number(id[1], CONTROLLER_OID_MAXIMUM) &&
+          s.literal(")") && s.atEnd())
+        line.type_ = L::NEW_COMPOSITE_STATE;
+    }
+    else if (s.literal("-> drive ")) {
+      if (s.number(id[0]) && s.literal(", ijt ") && s.time(line.injectionTime_) && s.atEnd())
+        line.type_ = L::DRIVE_INJECT;
+    }
+    return;
+
+  case 'm':
+    // The original regular expressions have an unescaped '.' in "mk.rdx", which matches any character.
+    if (s.literal("mk")) {
+      if (s.anyCharacter() && s.literal("rdx(") && s.number(id[0]) && s.literal("): I/O device eject ") &&
+          s.number(id[1]) && s.atEnd())
+        line.type_ = L::IO_DEVICE_EJECT_WITH_RDX;
+      return;
+    }
+
+    bool isModelOidInRange;
+    if (!(s.literal("mdl ") && s.number(id[0], OID_MAXIMUM, isModelOidInRange)))
+      return;
+
+    // The original code did not convert the model OID of a reduction line.
+    if (s.literal(" predict imdl -> mk")) {
+      if (s.anyCharacter() && s.literal("rdx ") && s.number(id[0]) && s.atEnd())
+        line.type_ = L::MODEL_IMDL_PREDICTION_REDUCTION;
+      return;
+    }
+    else if (s.literal(" predict -> mk")) {
+      if (s.anyCharacter() && s.literal("rdx ") && s.number(id[0]) && s.atEnd())
+        line.type_ = L::MODEL_PREDICTION_REDUCTION;
+      return;
+    }
+    else if (s.literal(" abduce -> mk")) {
+      if (s.anyCharacter() && s.literal("rdx ") && s.number(id[0]) && s.atEnd())
+        line.type_ = L::MODEL_ABDUCTION_REDUCTION;
+      return;
+    }
+    if (!isModelOidInRange)
+      return;
+
+    if (s.literal(" cnt:")) {
+      uint64 evidenceCount;
+      if (s.number(evidenceCount, EVIDENCE_COUNT_MAXIMUM) && s.literal(" sr:") &&
+          s.floatNumber(line.successRate_) && s.atEnd()) {
+        line.evidenceCount_ = (core::float32)evidenceCount;
+        line.type_ = L::SET_MODEL_EVIDENCE_COUNT_AND_SUCCESS_RATE;
+      }
+    }
+    else if (s.literal(" strength:")) {
+      if (s.floatNumber(line.strength_) && s.atEnd())
+        line.type_ = L::SET_MODEL_STRENGTH;
+    }
+    else if (s.literal(" deleted")) {
+      if (s.atEnd())
+        line.type_ = L::DELETE_MODEL;
+    }
+    else if (s.literal(" phased in")) {
+      if (s.atEnd())
+        line.type_ = L::PHASE_IN_MODEL;
+    }
+    else if (s.literal(" phased out")) {
+      if (s.atEnd())
+        line.type_ = L::PHASE_OUT_MODEL;
+    }
+    else if (s.literal(": fact (")) {
+      if (!(s.number(id[1]) && s.literal(") pred fact imdl")))
+        return;
+
+      if (s.literal(" -> fact ")) {
+        if (s.number(id[2]) && s.literal(" simulated pred, from goal req ") && s.number(id[3]) && s.atEnd())
+          line.type_ = L::MODEL_SIMULATED_PREDICTION_FROM_GOAL_REQUIREMENT;
+        return;
+      }
+
+      line.hasOptionalId_ = false;
+      if (s.literal(", from goal req ")) {
+        if (!s.number(id[2]))
+          return;
+        line.hasOptionalId_ = true;
+      }
+      if (!s.literal(", "))
+        return;
+      s.literal("simulated ");
+      if (s.literal("pred disabled by fact (") && s.number(id[3]) && s.literal(") pred |fact imdl") && s.atEnd())
+        line.type_ = L::MODEL_PREDICTION_DISABLED_BY_STRONG_REQUIREMENT;
+    }
+    else if (s.literal(": fact ")) {
+      if (!s.number(id[1]))
+        return;
+
+      if (s.literal(" super_goal -> fact ")) {
+        if (s.literal("(")) {
+          if (!(s.number(id[2]) && s.literal(") simulated pred start")))
+            return;
+          line.hasOptionalId_ = false;
+          if (s.literal(", using req (")) {
+            if (!(s.number(id[3]) && s.literal(")")))
+              return;
+            line.hasOptionalId_ = true;
+          }
+          if (s.literal(", ijt ") && s.time(line.injectionTime_) && s.atEnd())
+            line.type_ = L::MODEL_SIMULATED_PREDICTION_START;
+        }
+        else if (s.number(id[2]) && s.literal(" simulated goal") && s.atEnd())
+          line.type_ = L::MODEL_SIMULATED_ABDUCTION;
+      }
+      else if (s.literal(" pred -> fact ")) {
+        if (!(s.number(id[2]) && s.literal(" simulated pred")))
+          return;
+        line.flag_ = s.literal(" fact imdl");
+        line.hasOptionalId_ = false;
+        if (s.literal(", using req (")) {
+          if (!(s.number(id[3]) && s.literal(")")))
+            return;
+          line.hasOptionalId_ = true;
+        }
+        if (s.atEnd())
+          line.type_ = L::MODEL_SIMULATED_PREDICTION;
+      }
+    }
+    return;
+
+  case 'c':
+    if (!(s.literal("cst ") && s.number(id[0]) && s.literal(": fact ") && s.number(id[1])))
+      return;
+
+    if (s.literal(" super_goal -> fact ")) {
+      if (s.number(id[2]) && s.literal(" simulated goal") && s.atEnd())
+        line.type_ = L::COMPOSITE_STATE_SIMULATED_ABDUCTION;
+    }
+    else if (s.literal(" -> fact ")) {
+      line.inputs_.clear();
+      if (s.number(id[2]) && s.literal(" simulated pred fact icst ") && s.inputList(line.inputs_) && s.atEnd())
+        line.type_ = L::COMPOSITE_STATE_SIMULATED_PREDICTION;
+    }
+    return;
+
+  case 'A':
+    if (s.literal("A/F -> ") && s.number(id[0]) && s.literal("|") && s.number(id[1]) && s.literal(" (") &&
+        s.word(line.syncMode_) && s.literal(")") && s.atEnd())
+      line.type_ = L::AUTOFOCUS_NEW_OBJECT;
+    return;
+
+  case 'f':
+    bool isFactOidInRange;
+    if (!(s.literal("fact ") && s.number(id[0], OID_MAXIMUM, isFactOidInRange)))
+      return;
+
+    // The original code did not convert the input OID of a prediction success line.
+    if (s.literal(" -> fact ")) {
+      if (s.number(id[1]) && s.literal(" success fact ") && s.digits(id[2]) && s.literal(" pred") && s.atEnd())
+        line.type_ = L::PREDICTION_SUCCESS;
+      return;
+    }
+    if (!isFactOidInRange)
+      return;
+
+    if (s.literal(" icst[")) {
+      line.inputs_.clear();
+      if (s.digits(id[1]) && s.literal("]") && s.inputList(line.inputs_) && s.atEnd())
+        line.type_ = L::NEW_INSTANTIATED_COMPOSITE_STATE;
+    }
+    else if (s.literal(" pred fact (")) {
+      line.inputs_.clear();
+      if (s.digits(id[1]) && s.literal(") icst[") && s.digits(id[2]) && s.literal("]") &&
+          s.inputList(line.inputs_) && s.atEnd())
+        line.type_ = L::NEW_PREDICTED_INSTANTIATED_COMPOSITE_STATE;
+    }
+    else if (s.literal(" -> promoted simulated pred fact ")) {
+      if (s.number(id[1]) && s.literal(" w/ fact ") && s.number(id[2]) && s.literal(" timings") && s.atEnd())
+        line.type_ = L::PROMOTED_SIMULATED_PREDICTION;
+    }
+    else if (s.literal(": ")) {
+      if (s.digits(id[1]) && s.literal(" goal success (TopLevel)") && s.atEnd())
+        line.type_ = L::TOP_LEVEL_GOAL_SUCCESS;
+    }
+    return;
+
+  case '|':
+    if (s.literal("|fact ") && s.number(id[0]) && s.literal(" fact ") && s.digits(id[1]) &&
+        s.literal(" pred failure") && s.atEnd())
+      line.type_ = L::PREDICTION_FAILURE;
+    return;
+
+  case 'I':
+    if (s.literal("I/O device inject ")) {
+      if (s.number(id[0]) && s.literal(", ijt ") && s.time(line.injectionTime_) && s.atEnd())
+        line.type_ = L::IO_DEVICE_INJECT;
+    }
+    else if (s.literal("I/O device eject ")) {
+      if (s.number(id[0]) && s.atEnd())
+        line.type_ = L::IO_DEVICE_EJECT_WITHOUT_RDX;
+    }
+    return;
+
+  case 's':
+    if (s.literal("sim commit: fact ") && s.number(id[0]) && s.literal(" pred fact success -> fact (") &&
+        s.number(id[1]) && s.literal(") goal") && s.atEnd())
+      line.type_ = L::SIMULATION_COMMIT;
+    return;
+
+  case 'p':
+    // As with the original regex, this allows more text after the match.
+    if (s.literal("promoted simulated fact ") && s.number(id[0]) && s.literal(" defeated by fact ") && s.number(id[1]))
+      line.type_ = L::PROMOTED_SIMULATED_PREDICTION_DEFEATED;
+    return;
+  }
+}
+
+}
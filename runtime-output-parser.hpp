@@ -0,0 +1,228 @@
+//_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/
+//_/_/
+//_/_/ AERA Visualizer
+//_/_/ 
+//_/_/ Copyright (c) 2018-2022 Jeff Thompson
+//_/_/ Copyright (c) 2018-2022 Kristinn R. Thorisson
+//_/_/ Copyright (c) 2018-2022 Icelandic Institute for Intelligent Machines
+//_/_/ http://www.iiim.is
+//_/_/
+//_/_/ --- Open-Source BSD License, with CADIA Clause v 1.0 ---
+//_/_/
+//_/_/ Redistribution and use in source and binary forms, with or without
+//_/_/ modification, is permitted provided that the following conditions
+//_/_/ are met:
+//_/_/ - Redistributions of source code must retain the above copyright
+//_/_/   and collaboration notice, this list of conditions and the
+//_/_/   following disclaimer.
+//_/_/ - Redistributions in binary form must reproduce the above copyright
+//_/_/   notice, this list of conditions and the following disclaimer 
+//_/_/   in the documentation and/or other materials provided with 
+//_/_/   the distribution.
+//_/_/
+//_/_/ - Neither the name of its copyright holders nor the names of its
+//_/_/   contributors may be used to endorse or promote products
+//_/_/   derived from this software without specific prior 
+//_/_/   written permission.
+//_/_/   
+//_/_/ - CADIA Clause: The license granted in and to the software 
+//_/_/   under this agreement is a limited-use license. 
+//_/_/   The software may not be used in furtherance of:
+//_/_/    (i)   intentionally causing bodily injury or severe emotional 
+//_/_/          distress to any person;
+//_/_/    (ii)  invading the personal privacy or violating the human 
+//_/_/          rights of any person; or
+//_/_/    (iii) committing or preparing for any act of war.
+//_/_/
+//_/_/ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND 
+//_/_/ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+//_/_/ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF 
+//_/_/ MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+//_/_/ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR 
+//_/_/ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+//_/_/ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, 
+//_/_/ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+//_/_/ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+//_/_/ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+//_/_/ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+//_/_/ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+//_/_/ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY 
+//_/_/ OF SUCH DAMAGE.
+//_/_/ 
+//_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/
+
+#ifndef RUNTIME_OUTPUT_PARSER_HPP
+#define RUNTIME_OUTPUT_PARSER_HPP
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include "submodules/AERA/submodules/CoreLibrary/CoreLibrary/types.h"
+
+namespace aera_visualizer {
+
+/**
+ * A RuntimeOutputLine holds the values that RuntimeOutputParser::parse scans from
+ * one line of the runtime output file. The meaning of id_[i] depends on type_, as
+ * described for each Type. The parser only scans numbers. It is up to the caller to
+ * look up the objects and make the AeraEvent.
+ */
+class RuntimeOutputLine {
+public:
+  enum Type {
+    // The line does not match a known pattern. (It may still have a timestamp.)
+    NONE,
+    // load mdl 37, MDLController(113) strength:1 cnt:1 sr:1
+    // id_: mdl OID, controller debug OID. Also strength_, evidenceCount_, successRate_.
+    LOAD_MODEL,
+    // load cst 36, CSTController(98)
+    // id_: cst OID, controller debug OID.
+    LOAD_COMPOSITE_STATE,
+    // -> mdl 53, MDLController(389)
+    // id_: mdl OID, controller debug OID.
+    NEW_MODEL,
+    // mdl 53 cnt:2 sr:1
+    // id_: mdl OID. Also evidenceCount_, successRate_.
+    SET_MODEL_EVIDENCE_COUNT_AND_SUCCESS_RATE,
+    // mdl 75 strength:1
+    // id_: mdl OID. Also strength_.
+    SET_MODEL_STRENGTH,
+    // mdl 53 deleted
+    // id_: mdl OID.
+    DELETE_MODEL,
+    // mdl 53 phased in
+    // id_: mdl OID.
+    PHASE_IN_MODEL,
+    // mdl 53 phased out
+    // id_: mdl OID.
+    PHASE_OUT_MODEL,
+    // -> cst 52, CSTController(375)
+    // id_: cst OID, controller debug OID.
+    NEW_COMPOSITE_STATE,
+    // A/F -> 35|40 (AXIOM)
+    // id_: from OID, to OID. Also syncMode_.
+    AUTOFOCUS_NEW_OBJECT,
+    // mdl 61 predict imdl -> mk.rdx 559
+    // id_: mk.rdx OID.
+    MODEL_IMDL_PREDICTION_REDUCTION,
+    // mdl 67: fact (352225) pred fact imdl -> fact 588 simulated pred, from goal req 533
+    // id_: mdl OID, input detail OID, fact pred OID, goal requirement OID.
+    MODEL_SIMULATED_PREDICTION_FROM_GOAL_REQUIREMENT,
+    // mdl 67: fact (697996) pred fact imdl, from goal req 1250, simulated pred disabled by fact (696754) pred |fact imdl
+    // id_: mdl OID, input detail OID, goal requirement OID (if hasOptionalId_), strong requirement detail OID.
+    MODEL_PREDICTION_DISABLED_BY_STRONG_REQUIREMENT,
+    // mdl 63 predict -> mk.rdx 68
+    // id_: mk.rdx OID.
+    MODEL_PREDICTION_REDUCTION,
+    // mdl 41 abduce -> mk.rdx 97
+    // id_: mk.rdx OID.
+    MODEL_ABDUCTION_REDUCTION,
+    // mdl 64: fact 96 super_goal -> fact 98 simulated goal
+    // id_: mdl OID, super goal OID, goal OID.
+    MODEL_SIMULATED_ABDUCTION,
+    // cst 64: fact 96 super_goal -> fact 98 simulated goal
+    // id_: cst OID, super goal OID, goal OID.
+    COMPOSITE_STATE_SIMULATED_ABDUCTION,
+    // mdl 57: fact 202 pred -> fact 227 simulated pred fact imdl, using req (745971)
+    // id_: mdl OID, input OID, fact pred OID, requirement detail OID (if hasOptionalId_).
+    // Also flag_ is true for " fact imdl".
+    MODEL_SIMULATED_PREDICTION,
+    // mdl 63: fact 531 super_goal -> fact (332278) simulated pred start, using req (323845), ijt 0s:535ms:0us
+    // id_: mdl OID, input OID, fact pred detail OID, requirement detail OID (if hasOptionalId_).
+    // Also injectionTime_.
+    MODEL_SIMULATED_PREDICTION_START,
+    // cst 60: fact 195 -> fact 218 simulated pred fact icst [ 155 191]
+    // id_: cst OID, input OID, fact pred OID. Also inputs_.
+    COMPOSITE_STATE_SIMULATED_PREDICTION,
+    // fact 59 icst[52][ 50 55]
+    // id_: fact icst OID. Also inputs_.
+    NEW_INSTANTIATED_COMPOSITE_STATE,
+    // fact 59 pred fact (193775) icst[52][ 50 55]
+    // id_: fact pred fact icst OID. Also inputs_.
+    NEW_PREDICTED_INSTANTIATED_COMPOSITE_STATE,
+    // fact 75 -> fact 79 success fact 60 pred
+    // id_: input OID, fact success fact pred OID.
+    PREDICTION_SUCCESS,
+    // |fact 72 fact 59 pred failure
+    // id_: anti-fact success fact pred OID.
+    PREDICTION_FAILURE,
+    // fact 121: 96 goal success (TopLevel)
+    // id_: fact success fact goal OID, goal OID.
+    TOP_LEVEL_GOAL_SUCCESS,
+    // I/O device inject 46, ijt 0s:200ms:0us
+    // id_: object OID. Also injectionTime_.
+    IO_DEVICE_INJECT,
+    // mk.rdx(100): I/O device eject 39
+    // id_: mk.rdx detail OID, object OID.
+    IO_DEVICE_EJECT_WITH_RDX,
+    // I/O device eject 39
+    // id_: object OID.
+    IO_DEVICE_EJECT_WITHOUT_RDX,
+    // -> drive 158, ijt 0s:310ms:0us
+    // id_: object OID. Also injectionTime_.
+    DRIVE_INJECT,
+    // sim commit: fact 238 pred fact success -> fact (82115) goal
+    // id_: fact pred fact success OID, fact goal detail OID.
+    SIMULATION_COMMIT,
+    // fact 182 -> promoted simulated pred fact 250 w/ fact 247 timings
+    // id_: promoted from fact OID, promoted fact OID, timings fact OID.
+    PROMOTED_SIMULATED_PREDICTION,
+    // promoted simulated fact 251 defeated by fact 253
+    // id_: promoted fact OID, input OID.
+    PROMOTED_SIMULATED_PREDICTION_DEFEATED
+  };
+
+  RuntimeOutputLine()
+  : type_(NONE), hasTimestamp_(false), time_(0), injectionTime_(0), hasOptionalId_(false), flag_(false),
+    strength_(0), evidenceCount_(0), successRate_(0)
+  {
+    for (int i = 0; i < 4; ++i)
+      id_[i] = 0;
+  }
+
+  Type type_;
+  // True if the line starts with a timestamp. The lines for LOAD_MODEL and LOAD_COMPOSITE_STATE don't.
+  bool hasTimestamp_;
+  // The line timestamp, relative to the time reference. Only valid if hasTimestamp_.
+  std::chrono::microseconds time_;
+  // The ijt, relative to the time reference.
+  std::chrono::microseconds injectionTime_;
+  uint64 id_[4];
+  bool hasOptionalId_;
+  bool flag_;
+  core::float32 strength_;
+  core::float32 evidenceCount_;
+  core::float32 successRate_;
+  std::string syncMode_;
+  // The OIDs in an input list like "[ 50 55]".
+  std::vector<uint64> inputs_;
+};
+
+/**
+ * RuntimeOutputParser has static methods to scan the lines of the runtime output file.
+ * This is a hand-written scanner which dispatches on the first characters of the line
+ * and parses numbers in place, instead of trying a std::regex for each kind of line.
+ */
+class RuntimeOutputParser {
+public:
+  /**
+   * Scan the line between begin and end and set the fields of line. The accepted lines
+   * are the same as the original regular expressions in AeraVisulizerWindow::addEvents,
+   * as shown in the comments for RuntimeOutputLine::Type. A line is rejected if the original
+   * code would throw an exception to convert a number, such as an OID too large for stoul.
+   * \param begin A pointer to the first character of the line.
+   * \param end A pointer to the end of the line, not including the newline. If the line
+   * ends in a carriage return, it is ignored.
+   * \param line This sets line.type_ and line.hasTimestamp_ and the fields for the type. If
+   * line.type_ is NONE, then the other fields are undefined except hasTimestamp_ and time_.
+   * You can reuse the same line object for each call to reduce memory allocation.
+   */
+  static void parse(const char* begin, const char* end, RuntimeOutputLine& line);
+
+private:
+  static void parseAfterTimestamp(const char* begin, const char* end, RuntimeOutputLine& line);
+};
+
+}
+
+#endif
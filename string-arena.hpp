@@ -0,0 +1,146 @@
+//_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/
+//_/_/
+//_/_/ AERA Visualizer
+//_/_/ 
+//_/_/ Copyright (c) 2018-2022 Jeff Thompson
+//_/_/ Copyright (c) 2018-2022 Kristinn R. Thorisson
+//_/_/ Copyright (c) 2018-2022 Icelandic Institute for Intelligent Machines
+//_/_/ http://www.iiim.is
+//_/_/
+//_/_/ --- Open-Source BSD License, with CADIA Clause v 1.0 ---
+//_/_/
+//_/_/ Redistribution and use in source and binary forms, with or without
+//_/_/ modification, is permitted provided that the following conditions
+//_/_/ are met:
+//_/_/ - Redistributions of source code must retain the above copyright
+//_/_/   and collaboration notice, this list of conditions and the
+//_/_/   following disclaimer.
+//_/_/ - Redistributions in binary form must reproduce the above copyright
+//_/_/   notice, this list of conditions and the following disclaimer 
+//_/_/   in the documentation and/or other materials provided with 
+//_/_/   the distribution.
+//_/_/
+//_/_/ - Neither the name of its copyright holders nor the names of its
+//_/_/   contributors may be used to endorse or promote products
+//_/_/   derived from this software without specific prior 
+//_/_/   written permission.
+//_/_/   
+//_/_/ - CADIA Clause: The license granted in and to the software 
+//_/_/   under this agreement is a limited-use license. 
+//_/_/   The software may not be used in furtherance of:
+//_/_/    (i)   intentionally causing bodily injury or severe emotional 
+//_/_/          distress to any person;
+//_/_/    (ii)  invading the personal privacy or violating the human 
+//_/_/          rights of any person; or
+//_/_/    (iii) committing or preparing for any act of war.
+//_/_/
+//_/_/ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND 
+//_/_/ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+//_/_/ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF 
+//_/_/ MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+//_/_/ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR 
+//_/_/ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+//_/_/ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, 
+//_/_/ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+//_/_/ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+//_/_/ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+//_/_/ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+//_/_/ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+//_/_/ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY 
+//_/_/ OF SUCH DAMAGE.
+//_/_/ 
+//_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/
+
+#ifndef STRING_ARENA_HPP
+#define STRING_ARENA_HPP
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace aera_visualizer {
+
+/**
+ * A StringArena holds null-terminated strings in large blocks, so that adding a string does not
+ * allocate each time. A pointer returned by add() stays valid until the arena is destroyed.
+ */
+class StringArena {
+public:
+  StringArena()
+    : blockUsed_(0), blockSize_(0), nBytes_(0), nAllocatedBytes_(0)
+  {}
+
+  /**
+   * Copy the string into the arena.
+   * \param value The string, which should not contain a null character.
+   * \param size The number of characters in value.
+   * \return A pointer to the null-terminated copy.
+   */
+  const char* add(const char* value, size_t size)
+  {
+    if (blockUsed_ + size + 1 > blockSize_) {
+      // Put a large string in its own block.
+      blockSize_ = (size + 1 > BLOCK_SIZE ? size + 1 : BLOCK_SIZE);
+      blocks_.push_back(std::unique_ptr<char[]>(new char[blockSize_]));
+      blockUsed_ = 0;
+      nAllocatedBytes_ += blockSize_;
+    }
+
+    char* result = blocks_.back().get() + blockUsed_;
+    memcpy(result, value, size);
+    result[size] = 0;
+    blockUsed_ += size + 1;
+    nBytes_ += size + 1;
+    return result;
+  }
+
+  const char* add(const std::string& value) { return add(value.data(), value.size()); }
+
+  /**
+   * Get the number of bytes used by the added strings, including the null terminators.
+   */
+  size_t getUsedBytes() const { return nBytes_; }
+
+  /**
+   * Get the number of bytes allocated for blocks.
+   */
+  size_t getAllocatedBytes() const { return nAllocatedBytes_; }
+
+  /**
+   * A hash function on the null-terminated string (not the pointer), for an unordered_map
+   * keyed by strings in the arena.
+   */
+  struct Hash {
+    size_t operator()(const char* value) const
+    {
+      // FNV-1a.
+      size_t hash = (size_t)14695981039346656037ULL;
+      for (; *value; ++value) {
+        hash ^= (unsigned char)*value;
+        hash *= (size_t)1099511628211ULL;
+      }
+      return hash;
+    }
+  };
+
+  /**
+   * An equality test on the null-terminated strings (not the pointers).
+   */
+  struct Equal {
+    bool operator()(const char* x, const char* y) const { return strcmp(x, y) == 0; }
+  };
+
+private:
+  static const size_t BLOCK_SIZE = 1 << 20;
+
+  std::vector<std::unique_ptr<char[]> > blocks_;
+  size_t blockUsed_;
+  size_t blockSize_;
+  size_t nBytes_;
+  size_t nAllocatedBytes_;
+};
+
+}
+
+#endif
@@ -0,0 +1,156 @@
+//_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/
+//_/_/
+//_/_/ AERA Visualizer
+//_/_/ 
+//_/_/ Copyright (c) 2018-2022 Jeff Thompson
+//_/_/ Copyright (c) 2018-2022 Kristinn R. Thorisson
+//_/_/ Copyright (c) 2018-2022 Icelandic Institute for Intelligent Machines
+//_/_/ http://www.iiim.is
+//_/_/
+//_/_/ --- Open-Source BSD License, with CADIA Clause v 1.0 ---
+//_/_/
+//_/_/ Redistribution and use in source and binary forms, with or without
+//_/_/ modification, is permitted provided that the following conditions
+//_/_/ are met:
+//_/_/ - Redistributions of source code must retain the above copyright
+//_/_/   and collaboration notice, this list of conditions and the
+//_/_/   following disclaimer.
+//_/_/ - Redistributions in binary form must reproduce the above copyright
+//_/_/   notice, this list of conditions and the following disclaimer 
+//_/_/   in the documentation and/or other materials provided with 
+//_/_/   the distribution.
+//_/_/
+//_/_/ - Neither the name of its copyright holders nor the names of its
+//_/_/   contributors may be used to endorse or promote products
+//_/_/   derived from this software without specific prior 
+//_/_/   written permission.
+//_/_/   
+//_/_/ - CADIA Clause: The license granted in and to the software 
+//_/_/   under this agreement is a limited-use license. 
+//_/_/   The software may not be used in furtherance of:
+//_/_/    (i)   intentionally causing bodily injury or severe emotional 
+//_/_/          distress to any person;
+//_/_/    (ii)  invading the personal privacy or violating the human 
+//_/_/          rights of any person; or
+//_/_/    (iii) committing or preparing for any act of war.
+//_/_/
+//_/_/ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND 
+//_/_/ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+//_/_/ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF 
+//_/_/ MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+//_/_/ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR 
+//_/_/ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+//_/_/ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, 
+//_/_/ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+//_/_/ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+//_/_/ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+//_/_/ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+//_/_/ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+//_/_/ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY 
+//_/_/ OF SUCH DAMAGE.
+//_/_/ 
+//_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/
+// A test of ModelStateKeyframes::getModelStates. A keyframe only has the models changed by an
+// event before it, so this checks that a seek to any event, in particular a backward seek to
+// before a model's first change, gives the same model states as stepping from the first event.
+// Usage: model-state-keyframes-test
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include "submodules/AERA/r_exec/opcodes.h"
+#include "../model-state-keyframes.hpp"
+
+using namespace std;
+using namespace std::chrono;
+using namespace core;
+using namespace r_code;
+using namespace aera_visualizer;
+
+namespace {
+
+int nFailures = 0;
+
+void check(bool condition, const string& message)
+{
+  if (!condition) {
+    cout << "Failed: " << message << endl;
+    ++nFailures;
+  }
+}
+
+/**
+ * Set the model's initial strength, evidence count and success rate.
+ */
+void setModelValues(LocalObject& model, float32 strength, float32 evidenceCount, float32 successRate)
+{
+  model.resize_code(max(max(MDL_STRENGTH, MDL_CNT), MDL_SR) + 1);
+  model.code(MDL_STRENGTH) = Atom::Float(strength);
+  model.code(MDL_CNT) = Atom::Float(evidenceCount);
+  model.code(MDL_SR) = Atom::Float(successRate);
+}
+
+/**
+ * Check that states has the model with the expected values.
+ */
+void checkState(
+  const ModelStateKeyframes::ModelStates& states, Code* model, const string& name, size_t iEvent,
+  float32 strength, float32 evidenceCount, float32 successRate, ModelStateKeyframes::Phase phase)
+{
+  string where = name + " at event " + to_string(iEvent);
+  auto state = states.find(model);
+  check(state != states.end(), where + " is in the states");
+  if (state == states.end())
+    return;
+  check(state->second.strength_ == strength, where + " strength");
+  check(state->second.evidenceCount_ == evidenceCount, where + " evidence count");
+  check(state->second.successRate_ == successRate, where + " success rate");
+  check(state->second.phase_ == phase, where + " phase");
+}
+
+}
+
+int main()
+{
+  LocalObject modelA;
+  LocalObject modelB;
+  setModelValues(modelA, 1, 2, 0.5f);
+  setModelValues(modelB, 0.125f, 3, 0.25f);
+
+  // Model B's first change is in the third frame, after two keyframes which only have model A.
+  Timestamp timeReference(seconds(1));
+  auto samplingPeriod = milliseconds(100);
+  EventStore events;
+  events.push_back(make_unique<SetModelStrengthEvent>(timeReference + milliseconds(50), &modelA, 0.875f));
+  events.push_back(make_unique<SetModelEvidenceCountAndSuccessRateEvent>(
+    timeReference + milliseconds(150), &modelA, 4, 0.75f));
+  events.push_back(make_unique<SetModelStrengthEvent>(timeReference + milliseconds(250), &modelB, 0.625f));
+  events.push_back(make_unique<PhaseOutModelEvent>(timeReference + milliseconds(260), &modelB));
+  events.push_back(make_unique<SetModelEvidenceCountAndSuccessRateEvent>(
+    timeReference + milliseconds(350), &modelB, 5, 0.375f));
+
+  ModelStateKeyframes keyframes;
+  keyframes.build(events, timeReference, samplingPeriod, 1);
+
+  check(events.getStrength(0).oldStrength_ == 1, "old strength of model A");
+  check(events.getEvidenceCountAndSuccessRate(1).oldEvidenceCount_ == 2, "old evidence count of model A");
+  check(events.getStrength(2).oldStrength_ == 0.125f, "old strength of model B");
+  check(events.getEvidenceCountAndSuccessRate(4).oldSuccessRate_ == 0.25f, "old success rate of model B");
+
+  // Seek forward to the end, then backward to each event.
+  for (size_t iEvent = events.size() + 1; iEvent-- > 0;) {
+    ModelStateKeyframes::ModelStates states;
+    keyframes.getModelStates(events, iEvent, states);
+
+    checkState(
+      states, &modelA, "model A", iEvent, iEvent >= 1 ? 0.875f : 1, iEvent >= 2 ? 4 : 2, iEvent >= 2 ? 0.75f : 0.5f,
+      ModelStateKeyframes::PHASE_NORMAL);
+    checkState(
+      states, &modelB, "model B", iEvent, iEvent >= 3 ? 0.625f : 0.125f, iEvent >= 5 ? 5 : 3,
+      iEvent >= 5 ? 0.375f : 0.25f,
+      iEvent >= 4 ? ModelStateKeyframes::PHASE_PHASED_OUT : ModelStateKeyframes::PHASE_NORMAL);
+  }
+
+  cout << nFailures << " failures" << endl;
+  return nFailures == 0 ? 0 : 1;
+}
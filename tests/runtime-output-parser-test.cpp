@@ -0,0 +1,754 @@
+//_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/
+//_/_/
+//_/_/ AERA Visualizer
+//_/_/ 
+//_/_/ Copyright (c) 2018-2022 Jeff Thompson
+//_/_/ Copyright (c) 2018-2022 Kristinn R. Thorisson
+//_/_/ Copyright (c) 2018-2022 Icelandic Institute for Intelligent Machines
+//_/_/ http://www.iiim.is
+//_/_/
+//_/_/ --- Open-Source BSD License, with CADIA Clause v 1.0 ---
+//_/_/
+//_/_/ Redistribution and use in source and binary forms, with or without
+//_/_/ modification, is permitted provided that the following conditions
+//_/_/ are met:
+//_/_/ - Redistributions of source code must retain the above copyright
+//_/_/   and collaboration notice, this list of conditions and the
+//_/_/   following disclaimer.
+//_/_/ - Redistributions in binary form must reproduce the above copyright
+//_/_/   notice, this list of conditions and the following disclaimer 
+//_/_/   in the documentation and/or other materials provided with 
+//_/_/   the distribution.
+//_/_/
+//_/_/ - Neither the name of its copyright holders nor the names of its
+//_/_/   contributors may be used to endorse or promote products
+//_/_/   derived from this software without specific prior 
+//_/_/   written permission.
+//_/_/   
+//_/_/ - CADIA Clause: The license granted in and to the software 
+//_/_/   under this agreement is a limited-use license. 
+//_/_/   The software may not be used in furtherance of:
+//_/_/    (i)   intentionally causing bodily injury or severe emotional 
+//_/_/          distress to any person;
+//_/_/    (ii)  invading the personal privacy or violating the human 
+//_/_/          rights of any person; or
+//_/_/    (iii) committing or preparing for any act of war.
+//_/_/
+//_/_/ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND 
+//_/_/ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+//_/_/ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF 
+//_/_/ MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+//_/_/ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR 
+//_/_/ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+//_/_/ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, 
+//_/_/ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+//_/_/ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+//_/_/ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+//_/_/ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+//_/_/ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+//_/_/ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY 
+//_/_/ OF SUCH DAMAGE.
+//_/_/ 
+//_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/_/
+
+// A differential test of the runtime output parsing in AeraVisulizerWindow::addEvents against
+// the regular expressions which addEvents used before the scanner. The runtime output is the
+// lines of the sample runtime output files, followed by random mutations of these lines. The
+// test makes the startup events and the events in two ways:
+// - As the original addEvents did, with the regular expressions, holding back the events of
+//   the simulated prediction start lines in the pending events. If the original code would
+//   throw an exception for a line, for example from stof("."), the line has no event.
+// - With parseRuntimeOutputChunk and RuntimeOutputMerger, as addEvents does now, for the
+//   runtime output split into different numbers of chunks.
+// The events need the AERA objects, so each TestEvent has a description of the event class
+// and the constructor arguments which the original addEvents and newAeraEvent give it. The test
+// fails if a line gives a different event, or if the sequences of events are different.
+// Usage: runtime-output-parser-test [--mutations N] file1.txt [file2.txt ...]
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <random>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../runtime-output-parser.hpp"
+#include "../runtime-output-merger.hpp"
+
+using namespace std;
+using namespace std::chrono;
+using namespace aera_visualizer;
+
+namespace {
+
+typedef time_point<system_clock, microseconds> Timestamp;
+
+// The time reference of the runtime output.
+const Timestamp timeReference(seconds(1000));
+
+/**
+ * A TestEvent stands for the AeraEvent which addEvents makes for a line.
+ */
+class TestEvent {
+public:
+  TestEvent(Timestamp time, const string& description)
+  : time_(time), description_(description)
+  {}
+
+  Timestamp time_;
+  // The event class and the constructor arguments. An object is shown by its OID, or by
+  // "detail:" and its detail OID if it is found with getObjectByDetailOid.
+  string description_;
+};
+
+// The baseline regular expressions, in the order that addEvents tried them.
+const regex loadModelRegex("^load mdl (\\d+), MDLController\\((\\d+)\\) strength:([\\d\\.]+) cnt:(\\d+) sr:([\\d\\.]+)$");
+const regex loadCompositeStateRegex("^load cst (\\d+), CSTController\\((\\d+)\\)$");
+const regex timestampRegex("^(\\d+)s:(\\d+)ms:(\\d+)us (.+)$");
+const regex newModelRegex("^-> mdl (\\d+), MDLController\\((\\d+)\\)$");
+const regex setEvidenceCountAndSuccessRateRegex("^mdl (\\d+) cnt:(\\d+) sr:([\\d\\.]+)$");
+const regex setStrengthRegex("^mdl (\\d+) strength:([\\d\\.]+)$");
+const regex deleteOrPhaseInOrOutModelRegex("^mdl (\\d+) (deleted|phased in|phased out)$");
+const regex newCompositeStateRegex("^-> cst (\\d+), CSTController\\((\\d+)\\)$");
+const regex autofocusNewObjectRegex("^A/F -> (\\d+)\\|(\\d+) \\((\\w+)\\)$");
+const regex modelImdlPredictionReductionRegex("^mdl \\d+ predict imdl -> mk.rdx (\\d+)$");
+const regex modelSimulatedPredictionFromGoalRequirementRegex("^mdl (\\d+): fact \\((\\d+)\\) pred fact imdl -> fact (\\d+) simulated pred, from goal req (\\d+)$");
+const regex modelPredictionDisabledByStrongRequirementRegex("^mdl (\\d+): fact \\((\\d+)\\) pred fact imdl(, from goal req (\\d+))?, (simulated )?pred disabled by fact \\((\\d+)\\) pred \\|fact imdl$");
+const regex modelPredictionReductionRegex("^mdl \\d+ predict -> mk.rdx (\\d+)$");
+const regex modelAbductionReductionRegex("^mdl \\d+ abduce -> mk.rdx (\\d+)$");
+const regex modelSimulatedAbductionRegex("^mdl (\\d+): fact (\\d+) super_goal -> fact (\\d+) simulated goal$");
+const regex compositeStateSimulatedAbductionRegex("^cst (\\d+): fact (\\d+) super_goal -> fact (\\d+) simulated goal$");
+const regex modelSimulatedPredictionRegex("^mdl (\\d+): fact (\\d+) pred -> fact (\\d+) simulated pred( fact imdl)?(?:, using req \\((\\d+)\\))?$");
+const regex modelSimulatedPredictionStartRegex("^mdl (\\d+): fact (\\d+) super_goal -> fact \\((\\d+)\\) simulated pred start(?:, using req \\((\\d+)\\))?, ijt (\\d+)s:(\\d+)ms:(\\d+)us$");
+const regex compositeStateSimulatedPredictionRegex("^cst (\\d+): fact (\\d+) -> fact (\\d+) simulated pred fact icst \\[([ \\d]+)\\]$");
+const regex newInstantiatedCompositeStateRegex("^fact (\\d+) icst\\[\\d+\\]\\[([ \\d]+)\\]$");
+const regex newPredictedInstantiatedCompositeStateRegex("^fact (\\d+) pred fact \\(\\d+\\) icst\\[\\d+\\]\\[([ \\d]+)\\]$");
+const regex predictionSuccessRegex("^fact (\\d+) -> fact (\\d+) success fact \\d+ pred$");
+const regex predictionFailureRegex("^\\|fact (\\d+) fact \\d+ pred failure$");
+const regex topLevelGoalSuccessRegex("^fact (\\d+): (\\d+) goal success \\(TopLevel\\)$");
+const regex ioDeviceInjectRegex("^I/O device inject (\\d+), ijt (\\d+)s:(\\d+)ms:(\\d+)us$");
+const regex ioDeviceEjectWithRdxRegex("^mk.rdx\\((\\d+)\\): I/O device eject (\\d+)$");
+const regex ioDeviceEjectWithoutRdxRegex("^I/O device eject (\\d+)$");
+const regex driveInjectRegex("^-> drive (\\d+), ijt (\\d+)s:(\\d+)ms:(\\d+)us$");
+const regex simulationCommitRegex("^sim commit: fact (\\d+) pred fact success -> fact \\((\\d+)\\) goal$");
+const regex simulationPromotedSimulatedPredictionRegex("^fact (\\d+) -> promoted simulated pred fact (\\d+) w/ fact (\\d+) timings$");
+const regex simulationPromotedSimulatedPredictionDefeatedRegex("^promoted simulated fact (\\d+) defeated by fact (\\d+)");
+const regex inputOidRegex("( \\d+)");
+
+/**
+ * A Description builds the description of a TestEvent. Each value is preceded by a space.
+ */
+class Description {
+public:
+  Description(const string& eventClass) { out_ << eventClass; }
+
+  template<class T> Description& operator<<(const T& value)
+  {
+    out_ << " " << value;
+    return *this;
+  }
+
+  // Show all the digits of a float.
+  Description& operator<<(core::float32 value)
+  {
+    out_ << " " << setprecision(9) << value;
+    return *this;
+  }
+
+  Description& operator<<(Timestamp time)
+  {
+    out_ << " " << (time - timeReference).count() << "us";
+    return *this;
+  }
+
+  Description& operator<<(const vector<uint64>& oids)
+  {
+    out_ << " [";
+    for (size_t i = 0; i < oids.size(); ++i)
+      out_ << (i == 0 ? "" : " ") << oids[i];
+    out_ << "]";
+    return *this;
+  }
+
+  string str() const { return out_.str(); }
+
+private:
+  ostringstream out_;
+};
+
+string detail(uint64 oid) { return "detail:" + to_string(oid); }
+
+// Convert as the original addEvents did. (stoul and stoll have the size of unsigned long and
+// long long on the platform.) These throw an exception if the number is out of range.
+uint64 getOid(const smatch& matches, int i) { return stoul(matches[i].str()); }
+long long getControllerOid(const smatch& matches, int i) { return stoll(matches[i].str()); }
+
+/**
+ * Get the timestamp of the three groups "(\d+)s:(\d+)ms:(\d+)us" starting at group i, as
+ * the original AeraVisulizerWindow::getTimestamp did.
+ */
+Timestamp getTimestamp(const smatch& matches, int i)
+{
+  // Multiply as unsigned to get the same value as the original code without signed overflow.
+  return timeReference + microseconds((long long)(
+    1000000 * (unsigned long long)stoll(matches[i].str()) + 1000 * (unsigned long long)stoll(matches[i + 1].str()) +
+    (unsigned long long)stoll(matches[i + 2].str())));
+}
+
+/**
+ * Get the OIDs of an input list like " 50 55", as the original addEvents did.
+ */
+vector<uint64> getInputOids(string inputOids)
+{
+  vector<uint64> result;
+  smatch matches;
+  while (regex_search(inputOids, matches, inputOidRegex)) {
+    result.push_back(getOid(matches, 1));
+    inputOids = matches.suffix();
+  }
+  return result;
+}
+
+/**
+ * Make the event for the line as the original addEvents did with the regular expressions, where
+ * all objects are found.
+ * \param line The line, without the newline or a final carriage return.
+ * \param type Set this to the type of line matched by a regular expression, or NONE.
+ * \param hasTimestamp Set this true if the line has a timestamp, or false if not.
+ * \param timestamp If the line has a timestamp, set this to it. The original addEvents moved
+ * the pending events up to this time to the events before adding the line's event.
+ * \return The event, or null if none. This throws an exception if the original code would throw,
+ * in which case hasTimestamp and timestamp are set if the timestamp was converted.
+ */
+unique_ptr<TestEvent> newEventWithRegex(
+  const string& line, RuntimeOutputLine::Type& type, bool& hasTimestamp, Timestamp& timestamp)
+{
+  typedef RuntimeOutputLine L;
+  type = L::NONE;
+  hasTimestamp = false;
+  smatch matches;
+  if (regex_search(line, matches, loadModelRegex)) {
+    type = L::LOAD_MODEL;
+    return make_unique<TestEvent>(timeReference, (Description("NewModelEvent") << getOid(matches, 1) <<
+      stof(matches[3].str()) << (core::float32)stol(matches[4].str()) << stof(matches[5].str()) <<
+      getControllerOid(matches, 2)).str());
+  }
+  if (regex_search(line, matches, loadCompositeStateRegex)) {
+    type = L::LOAD_COMPOSITE_STATE;
+    return make_unique<TestEvent>(timeReference, (Description("NewCompositeStateEvent") << getOid(matches, 1) <<
+      getControllerOid(matches, 2)).str());
+  }
+  if (!regex_search(line, matches, timestampRegex))
+    return unique_ptr<TestEvent>();
+
+  timestamp = getTimestamp(matches, 1);
+  hasTimestamp = true;
+  string lineAfterTimestamp = matches[4].str();
+  const string& a = lineAfterTimestamp;
+  Timestamp t = timestamp;
+  if (regex_search(a, matches, newModelRegex)) {
+    type = L::NEW_MODEL;
+    return make_unique<TestEvent>(t, (Description("NewModelEvent") << getOid(matches, 1) <<
+      (core::float32)0 << (core::float32)1 << (core::float32)1 << getControllerOid(matches, 2)).str());
+  }
+  if (regex_search(a, matches, setEvidenceCountAndSuccessRateRegex)) {
+    type = L::SET_MODEL_EVIDENCE_COUNT_AND_SUCCESS_RATE;
+    return make_unique<TestEvent>(t, (Description("SetModelEvidenceCountAndSuccessRateEvent") <<
+      getOid(matches, 1) << (core::float32)stol(matches[2].str()) << stof(matches[3].str())).str());
+  }
+  if (regex_search(a, matches, setStrengthRegex)) {
+    type = L::SET_MODEL_STRENGTH;
+    return make_unique<TestEvent>(t, (Description("SetModelStrengthEvent") << getOid(matches, 1) <<
+      stof(matches[2].str())).str());
+  }
+  if (regex_search(a, matches, deleteOrPhaseInOrOutModelRegex)) {
+    uint64 model = getOid(matches, 1);
+    if (matches[2] == "phased in") {
+      type = L::PHASE_IN_MODEL;
+      return make_unique<TestEvent>(t, (Description("PhaseInModelEvent") << model).str());
+    }
+    if (matches[2] == "phased out") {
+      type = L::PHASE_OUT_MODEL;
+      return make_unique<TestEvent>(t, (Description("PhaseOutModelEvent") << model).str());
+    }
+    type = L::DELETE_MODEL;
+    return make_unique<TestEvent>(t, (Description("DeleteModelEvent") << model).str());
+  }
+  if (regex_search(a, matches, newCompositeStateRegex)) {
+    type = L::NEW_COMPOSITE_STATE;
+    return make_unique<TestEvent>(t, (Description("NewCompositeStateEvent") << getOid(matches, 1) <<
+      getControllerOid(matches, 2)).str());
+  }
+  if (regex_search(a, matches, autofocusNewObjectRegex)) {
+    type = L::AUTOFOCUS_NEW_OBJECT;
+    return make_unique<TestEvent>(t, (Description("AutoFocusNewObjectEvent") << getOid(matches, 1) <<
+      getOid(matches, 2) << matches[3].str()).str());
+  }
+  if (regex_search(a, matches, modelImdlPredictionReductionRegex)) {
+    // The event class and arguments come from the reduction object.
+    type = L::MODEL_IMDL_PREDICTION_REDUCTION;
+    return make_unique<TestEvent>(t, (Description("ModelImdlPredictionEvent from mk.rdx") << getOid(matches, 1)).str());
+  }
+  if (regex_search(a, matches, modelSimulatedPredictionFromGoalRequirementRegex)) {
+    type = L::MODEL_SIMULATED_PREDICTION_FROM_GOAL_REQUIREMENT;
+    return make_unique<TestEvent>(t, (Description("ModelSimulatedPredictionReductionFromGoalRequirement") <<
+      getOid(matches, 1) << getOid(matches, 3) << detail(getOid(matches, 2)) << getOid(matches, 4)).str());
+  }
+  if (regex_search(a, matches, modelPredictionDisabledByStrongRequirementRegex)) {
+    type = L::MODEL_PREDICTION_DISABLED_BY_STRONG_REQUIREMENT;
+    string goalRequirement = (matches[4].length() > 0 ? to_string(getOid(matches, 4)) : "0");
+    return make_unique<TestEvent>(t, (Description("ModelPredictionFromRequirementDisabledEvent") <<
+      getOid(matches, 1) << detail(getOid(matches, 2)) << goalRequirement << detail(getOid(matches, 6))).str());
+  }
+  if (regex_search(a, matches, modelPredictionReductionRegex)) {
+    type = L::MODEL_PREDICTION_REDUCTION;
+    return make_unique<TestEvent>(t, (Description("ModelMkValPredictionReduction") << getOid(matches, 1)).str());
+  }
+  if (regex_search(a, matches, modelAbductionReductionRegex)) {
+    type = L::MODEL_ABDUCTION_REDUCTION;
+    return make_unique<TestEvent>(t, (Description("ModelGoalReduction from mk.rdx") << getOid(matches, 1)).str());
+  }
+  if (regex_search(a, matches, modelSimulatedAbductionRegex)) {
+    type = L::MODEL_SIMULATED_ABDUCTION;
+    return make_unique<TestEvent>(t, (Description("ModelGoalReduction") << getOid(matches, 1) <<
+      getOid(matches, 3) << getOid(matches, 2)).str());
+  }
+  if (regex_search(a, matches, compositeStateSimulatedAbductionRegex)) {
+    type = L::COMPOSITE_STATE_SIMULATED_ABDUCTION;
+    return make_unique<TestEvent>(t, (Description("CompositeStateGoalReduction") << getOid(matches, 1) <<
+      getOid(matches, 3) << getOid(matches, 2)).str());
+  }
+  if (regex_search(a, matches, modelSimulatedPredictionRegex)) {
+    type = L::MODEL_SIMULATED_PREDICTION;
+    string requirement = (matches[5].length() > 0 ? detail(getOid(matches, 5)) : "0");
+    return make_unique<TestEvent>(t, (Description("ModelSimulatedPredictionReduction") << getOid(matches, 1) <<
+      getOid(matches, 3) << getOid(matches, 2) << requirement << false << (matches[4] == " fact imdl")).str());
+  }
+  if (regex_search(a, matches, modelSimulatedPredictionStartRegex)) {
+    type = L::MODEL_SIMULATED_PREDICTION_START;
+    string requirement = (matches[4].length() > 0 ? detail(getOid(matches, 4)) : "0");
+    Timestamp injectionTime = getTimestamp(matches, 5);
+    if (injectionTime < timestamp)
+      injectionTime = timestamp;
+    return make_unique<TestEvent>(injectionTime, (Description("ModelSimulatedPredictionReduction") <<
+      getOid(matches, 1) << detail(getOid(matches, 3)) << getOid(matches, 2) << requirement << true << false).str());
+  }
+  if (regex_search(a, matches, compositeStateSimulatedPredictionRegex)) {
+    type = L::COMPOSITE_STATE_SIMULATED_PREDICTION;
+    return make_unique<TestEvent>(t, (Description("CompositeStateSimulatedPredictionReduction") <<
+      getOid(matches, 1) << getOid(matches, 3) << getOid(matches, 2) << getInputOids(matches[4].str())).str());
+  }
+  if (regex_search(a, matches, newInstantiatedCompositeStateRegex)) {
+    type = L::NEW_INSTANTIATED_COMPOSITE_STATE;
+    return make_unique<TestEvent>(t, (Description("NewInstantiatedCompositeStateEvent") << getOid(matches, 1) <<
+      getInputOids(matches[2].str())).str());
+  }
+  if (regex_search(a, matches, newPredictedInstantiatedCompositeStateRegex)) {
+    type = L::NEW_PREDICTED_INSTANTIATED_COMPOSITE_STATE;
+    return make_unique<TestEvent>(t, (Description("NewPredictedInstantiatedCompositeStateEvent") <<
+      getOid(matches, 1) << getInputOids(matches[2].str())).str());
+  }
+  if (regex_search(a, matches, predictionSuccessRegex)) {
+    type = L::PREDICTION_SUCCESS;
+    return make_unique<TestEvent>(t, (Description("PredictionResultEvent") << getOid(matches, 2)).str());
+  }
+  if (regex_search(a, matches, predictionFailureRegex)) {
+    type = L::PREDICTION_FAILURE;
+    return make_unique<TestEvent>(t, (Description("PredictionResultEvent") << getOid(matches, 1)).str());
+  }
+  if (regex_search(a, matches, topLevelGoalSuccessRegex)) {
+    // The original code got the object but did not add an event.
+    getOid(matches, 1);
+    type = L::TOP_LEVEL_GOAL_SUCCESS;
+    return unique_ptr<TestEvent>();
+  }
+  if (regex_search(a, matches, ioDeviceInjectRegex)) {
+    type = L::IO_DEVICE_INJECT;
+    return make_unique<TestEvent>(t, (Description("IoDeviceInjectEvent") << getOid(matches, 1) <<
+      getTimestamp(matches, 2)).str());
+  }
+  if (regex_search(a, matches, ioDeviceEjectWithRdxRegex)) {
+    type = L::IO_DEVICE_EJECT_WITH_RDX;
+    return make_unique<TestEvent>(t, (Description("IoDeviceEjectEvent") << getOid(matches, 2) <<
+      detail(getOid(matches, 1))).str());
+  }
+  if (regex_search(a, matches, ioDeviceEjectWithoutRdxRegex)) {
+    type = L::IO_DEVICE_EJECT_WITHOUT_RDX;
+    return make_unique<TestEvent>(t, (Description("IoDeviceEjectEvent") << getOid(matches, 1) << 0).str());
+  }
+  if (regex_search(a, matches, driveInjectRegex)) {
+    type = L::DRIVE_INJECT;
+    return make_unique<TestEvent>(t, (Description("DriveInjectEvent") << getOid(matches, 1) <<
+      getTimestamp(matches, 2)).str());
+  }
+  if (regex_search(a, matches, simulationCommitRegex)) {
+    type = L::SIMULATION_COMMIT;
+    return make_unique<TestEvent>(t, (Description("SimulationCommitEvent") << detail(getOid(matches, 2)) <<
+      getOid(matches, 1)).str());
+  }
+  if (regex_search(a, matches, simulationPromotedSimulatedPredictionRegex)) {
+    type = L::PROMOTED_SIMULATED_PREDICTION;
+    return make_unique<TestEvent>(t, (Description("PromotedSimulatedPredictionEvent") << getOid(matches, 2) <<
+      getOid(matches, 1) << getOid(matches, 3)).str());
+  }
+  if (regex_search(a, matches, simulationPromotedSimulatedPredictionDefeatedRegex)) {
+    type = L::PROMOTED_SIMULATED_PREDICTION_DEFEATED;
+    return make_unique<TestEvent>(t, (Description("PromotedSimulatedPredictionDefeatEvent") << getOid(matches, 2) <<
+      getOid(matches, 1)).str());
+  }
+
+  return unique_ptr<TestEvent>();
+}
+
+/**
+ * Make the event for the parsed line with the same arguments as AeraVisulizerWindow::newAeraEvent,
+ * where all objects are found.
+ * \param line The parsed line.
+ * \return The event, or null if none.
+ */
+unique_ptr<TestEvent> newEventWithParser(const RuntimeOutputLine& line)
+{
+  typedef RuntimeOutputLine L;
+  const uint64* id = line.id_;
+
+  if (line.type_ == L::LOAD_MODEL)
+    return make_unique<TestEvent>(timeReference, (Description("NewModelEvent") << id[0] << line.strength_ <<
+      line.evidenceCount_ << line.successRate_ << id[1]).str());
+  if (line.type_ == L::LOAD_COMPOSITE_STATE)
+    return make_unique<TestEvent>(timeReference, (Description("NewCompositeStateEvent") << id[0] << id[1]).str());
+
+  if (!line.hasTimestamp_)
+    return unique_ptr<TestEvent>();
+  Timestamp t = timeReference + line.time_;
+
+  switch (line.type_) {
+  case L::NEW_MODEL:
+    return make_unique<TestEvent>(t, (Description("NewModelEvent") << id[0] << (core::float32)0 <<
+      (core::float32)1 << (core::float32)1 << id[1]).str());
+  case L::SET_MODEL_EVIDENCE_COUNT_AND_SUCCESS_RATE:
+    return make_unique<TestEvent>(t, (Description("SetModelEvidenceCountAndSuccessRateEvent") << id[0] <<
+      line.evidenceCount_ << line.successRate_).str());
+  case L::SET_MODEL_STRENGTH:
+    return make_unique<TestEvent>(t, (Description("SetModelStrengthEvent") << id[0] << line.strength_).str());
+  case L::PHASE_IN_MODEL:
+    return make_unique<TestEvent>(t, (Description("PhaseInModelEvent") << id[0]).str());
+  case L::PHASE_OUT_MODEL:
+    return make_unique<TestEvent>(t, (Description("PhaseOutModelEvent") << id[0]).str());
+  case L::DELETE_MODEL:
+    return make_unique<TestEvent>(t, (Description("DeleteModelEvent") << id[0]).str());
+  case L::NEW_COMPOSITE_STATE:
+    return make_unique<TestEvent>(t, (Description("NewCompositeStateEvent") << id[0] << id[1]).str());
+  case L::AUTOFOCUS_NEW_OBJECT:
+    return make_unique<TestEvent>(t, (Description("AutoFocusNewObjectEvent") << id[0] << id[1] <<
+      line.syncMode_).str());
+  case L::MODEL_IMDL_PREDICTION_REDUCTION:
+    return make_unique<TestEvent>(t, (Description("ModelImdlPredictionEvent from mk.rdx") << id[0]).str());
+  case L::MODEL_SIMULATED_PREDICTION_FROM_GOAL_REQUIREMENT:
+    return make_unique<TestEvent>(t, (Description("ModelSimulatedPredictionReductionFromGoalRequirement") <<
+      id[0] << id[2] << detail(id[1]) << id[3]).str());
+  case L::MODEL_PREDICTION_DISABLED_BY_STRONG_REQUIREMENT:
+    return make_unique<TestEvent>(t, (Description("ModelPredictionFromRequirementDisabledEvent") << id[0] <<
+      detail(id[1]) << (line.hasOptionalId_ ? to_string(id[2]) : "0") << detail(id[3])).str());
+  case L::MODEL_PREDICTION_REDUCTION:
+    return make_unique<TestEvent>(t, (Description("ModelMkValPredictionReduction") << id[0]).str());
+  case L::MODEL_ABDUCTION_REDUCTION:
+    return make_unique<TestEvent>(t, (Description("ModelGoalReduction from mk.rdx") << id[0]).str());
+  case L::MODEL_SIMULATED_ABDUCTION:
+    return make_unique<TestEvent>(t, (Description("ModelGoalReduction") << id[0] << id[2] << id[1]).str());
+  case L::COMPOSITE_STATE_SIMULATED_ABDUCTION:
+    return make_unique<TestEvent>(t, (Description("CompositeStateGoalReduction") << id[0] << id[2] << id[1]).str());
+  case L::MODEL_SIMULATED_PREDICTION:
+    return make_unique<TestEvent>(t, (Description("ModelSimulatedPredictionReduction") << id[0] << id[2] <<
+      id[1] << (line.hasOptionalId_ ? detail(id[3]) : "0") << false << line.flag_).str());
+  case L::MODEL_SIMULATED_PREDICTION_START: {
+    Timestamp injectionTime = timeReference + line.injectionTime_;
+    if (injectionTime < t)
+      injectionTime = t;
+    return make_unique<TestEvent>(injectionTime, (Description("ModelSimulatedPredictionReduction") << id[0] <<
+      detail(id[2]) << id[1] << (line.hasOptionalId_ ? detail(id[3]) : "0") << true << false).str());
+  }
+  case L::COMPOSITE_STATE_SIMULATED_PREDICTION:
+    return make_unique<TestEvent>(t, (Description("CompositeStateSimulatedPredictionReduction") << id[0] <<
+      id[2] << id[1] << line.inputs_).str());
+  case L::NEW_INSTANTIATED_COMPOSITE_STATE:
+    return make_unique<TestEvent>(t, (Description("NewInstantiatedCompositeStateEvent") << id[0] <<
+      line.inputs_).str());
+  case L::NEW_PREDICTED_INSTANTIATED_COMPOSITE_STATE:
+    return make_unique<TestEvent>(t, (Description("NewPredictedInstantiatedCompositeStateEvent") << id[0] <<
+      line.inputs_).str());
+  case L::PREDICTION_SUCCESS:
+    return make_unique<TestEvent>(t, (Description("PredictionResultEvent") << id[1]).str());
+  case L::PREDICTION_FAILURE:
+    return make_unique<TestEvent>(t, (Description("PredictionResultEvent") << id[0]).str());
+  case L::IO_DEVICE_INJECT:
+    return make_unique<TestEvent>(t, (Description("IoDeviceInjectEvent") << id[0] <<
+      timeReference + line.injectionTime_).str());
+  case L::IO_DEVICE_EJECT_WITH_RDX:
+    return make_unique<TestEvent>(t, (Description("IoDeviceEjectEvent") << id[1] << detail(id[0])).str());
+  case L::IO_DEVICE_EJECT_WITHOUT_RDX:
+    return make_unique<TestEvent>(t, (Description("IoDeviceEjectEvent") << id[0] << 0).str());
+  case L::DRIVE_INJECT:
+    return make_unique<TestEvent>(t, (Description("DriveInjectEvent") << id[0] <<
+      timeReference + line.injectionTime_).str());
+  case L::SIMULATION_COMMIT:
+    return make_unique<TestEvent>(t, (Description("SimulationCommitEvent") << detail(id[1]) << id[0]).str());
+  case L::PROMOTED_SIMULATED_PREDICTION:
+    return make_unique<TestEvent>(t, (Description("PromotedSimulatedPredictionEvent") << id[1] << id[0] <<
+      id[2]).str());
+  case L::PROMOTED_SIMULATED_PREDICTION_DEFEATED:
+    return make_unique<TestEvent>(t, (Description("PromotedSimulatedPredictionDefeatEvent") << id[1] <<
+      id[0]).str());
+  default:
+    // This includes TOP_LEVEL_GOAL_SUCCESS, which has no event.
+    return unique_ptr<TestEvent>();
+  }
+}
+
+/**
+ * Remove a final carriage return. The original addEvents used getline, which kept it, but the
+ * scanner ignores it, so the regular expressions get the line without it.
+ */
+string withoutReturn(const string& line)
+{
+  if (!line.empty() && line.back() == '\r')
+    return line.substr(0, line.size() - 1);
+  return line;
+}
+
+string describe(const unique_ptr<TestEvent>& event)
+{
+  if (!event)
+    return "no event";
+  return (Description("") << event->time_).str().substr(1) + " " + event->description_;
+}
+
+/**
+ * Compare newEventWithRegex and the parser with newEventWithParser for the line, and print the
+ * difference if any. If the original code would throw an exception for the line, then the parser
+ * must reject the line so that it has no event, and it must only have a timestamp if the original
+ * code converted the timestamp.
+ * \param line The line, which may end in a carriage return.
+ * \return True if the line has the same type, timestamp and event.
+ */
+bool compareLine(const string& line)
+{
+  RuntimeOutputLine::Type expectedType;
+  bool expectedHasTimestamp;
+  Timestamp expectedTimestamp;
+  unique_ptr<TestEvent> expectedEvent;
+  bool baselineThrows = false;
+  try {
+    expectedEvent = newEventWithRegex(withoutReturn(line), expectedType, expectedHasTimestamp, expectedTimestamp);
+  } catch (const exception&) {
+    baselineThrows = true;
+    expectedType = RuntimeOutputLine::NONE;
+  }
+
+  RuntimeOutputLine parsed;
+  RuntimeOutputParser::parse(line.data(), line.data() + line.size(), parsed);
+  auto event = newEventWithParser(parsed);
+
+  bool same = (parsed.type_ == expectedType && parsed.hasTimestamp_ == expectedHasTimestamp &&
+    (!expectedHasTimestamp || timeReference + parsed.time_ == expectedTimestamp) &&
+    describe(event) == describe(expectedEvent));
+  if (same)
+    return true;
+
+  cout << "Difference for line [" << line << "]" << endl;
+  cout << "  regex:  type " << expectedType << (baselineThrows ? " (exception)" : "") <<
+    (expectedHasTimestamp ? ", timestamp " + to_string((expectedTimestamp - timeReference).count()) : "") <<
+    ", " << describe(expectedEvent) << endl;
+  cout << "  parser: type " << parsed.type_ <<
+    (parsed.hasTimestamp_ ? ", timestamp " + to_string(parsed.time_.count()) : "") << ", " << describe(event) << endl;
+  return false;
+}
+
+/**
+ * Make the startup events and events as the original addEvents did with the regular expressions.
+ * \param lines The lines of the runtime output.
+ * \param startupEvents Add the startup events to this list.
+ * \param events Add the events to this list.
+ */
+void addEventsWithRegex(
+  const vector<string>& lines, vector<unique_ptr<TestEvent> >& startupEvents, vector<unique_ptr<TestEvent> >& events)
+{
+  // pendingEvents is an ordered map keyed by event time. The value is a list of pending events at the time.
+  map<Timestamp, vector<unique_ptr<TestEvent> > > pendingEvents;
+  for (auto line = lines.begin(); line != lines.end(); ++line) {
+    RuntimeOutputLine::Type type = RuntimeOutputLine::NONE;
+    bool hasTimestamp = false;
+    Timestamp timestamp;
+    unique_ptr<TestEvent> event;
+    try {
+      event = newEventWithRegex(withoutReturn(*line), type, hasTimestamp, timestamp);
+    } catch (const exception&) {
+      // The original addEvents would stop. Continue without an event for the line.
+    }
+
+    if (hasTimestamp) {
+      // The original addEvents did this before making the event.
+      while (pendingEvents.size() >= 1 && pendingEvents.begin()->first <= timestamp) {
+        for (size_t i = 0; i < pendingEvents.begin()->second.size(); ++i)
+          events.push_back(move(pendingEvents.begin()->second[i]));
+        pendingEvents.erase(pendingEvents.begin());
+      }
+    }
+
+    if (!event)
+      continue;
+    if (type == RuntimeOutputLine::LOAD_MODEL || type == RuntimeOutputLine::LOAD_COMPOSITE_STATE)
+      startupEvents.push_back(move(event));
+    else if (type == RuntimeOutputLine::MODEL_SIMULATED_PREDICTION_START)
+      pendingEvents[event->time_].push_back(move(event));
+    else
+      events.push_back(move(event));
+  }
+
+  // Transfer any remaining pendingEvents to events.
+  for (auto event = pendingEvents.begin(); event != pendingEvents.end(); ++event) {
+    for (size_t i = 0; i < event->second.size(); ++i)
+      events.push_back(move(event->second[i]));
+  }
+}
+
+/**
+ * Make the startup events and events as addEvents does, with parseRuntimeOutputChunk for each
+ * chunk and RuntimeOutputMerger.
+ * \param runtimeOutput The runtime output.
+ * \param nChunks The number of chunks to split the runtime output into at line boundaries.
+ * \param startupEvents Add the startup events to this list.
+ * \param events Add the events to this list.
+ */
+void addEventsWithParser(
+  const string& runtimeOutput, size_t nChunks, vector<unique_ptr<TestEvent> >& startupEvents,
+  vector<unique_ptr<TestEvent> >& events)
+{
+  const char* fileData = runtimeOutput.data();
+  const char* fileEnd = fileData + runtimeOutput.size();
+  vector<const char*> chunkBegin(nChunks + 1);
+  chunkBegin[0] = fileData;
+  chunkBegin[nChunks] = fileEnd;
+  for (size_t i = 1; i < nChunks; ++i) {
+    const char* begin = max(chunkBegin[i - 1], fileData + runtimeOutput.size() * i / nChunks);
+    const char* newline = (const char*)memchr(begin, '\n', fileEnd - begin);
+    chunkBegin[i] = (newline ? newline + 1 : fileEnd);
+  }
+
+  vector<vector<RuntimeOutputEntry<TestEvent> > > chunkEntries(nChunks);
+  atomic<int64> bytesParsed(0);
+  atomic<bool> canceled(false);
+  for (size_t i = 0; i < nChunks; ++i)
+    parseRuntimeOutputChunk<TestEvent>(
+      chunkBegin[i], chunkBegin[i + 1], timeReference, newEventWithParser, chunkEntries[i], bytesParsed, canceled);
+
+  RuntimeOutputMerger<TestEvent> merger;
+  auto addStartupEvent = [&](RuntimeOutputLine::Type, unique_ptr<TestEvent> event) {
+    startupEvents.push_back(move(event));
+  };
+  auto addEvent = [&](unique_ptr<TestEvent> event) { events.push_back(move(event)); };
+  for (size_t i = 0; i < nChunks; ++i) {
+    for (size_t iEntry = 0; iEntry < chunkEntries[i].size(); ++iEntry)
+      merger.add(chunkEntries[i][iEntry], addStartupEvent, addEvent);
+  }
+  merger.finish(addEvent);
+}
+
+/**
+ * Compare the expected and actual events, and print the first difference if any.
+ * \return True if the events are the same.
+ */
+bool compareEvents(
+  const string& name, const vector<unique_ptr<TestEvent> >& expected, const vector<unique_ptr<TestEvent> >& actual)
+{
+  for (size_t i = 0; i < max(expected.size(), actual.size()); ++i) {
+    string expectedDescription = (i < expected.size() ? describe(expected[i]) : "(end)");
+    string actualDescription = (i < actual.size() ? describe(actual[i]) : "(end)");
+    if (actualDescription != expectedDescription) {
+      cout << "Difference in " << name << " at index " << i << " of " << expected.size() << endl <<
+        "  regex:  " << expectedDescription << endl << "  parser: " << actualDescription << endl;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+  int nMutations = 20000;
+  vector<string> lines;
+  for (int i = 1; i < argc; ++i) {
+    if (string(argv[i]) == "--mutations" && i + 1 < argc) {
+      nMutations = atoi(argv[++i]);
+      continue;
+    }
+
+    ifstream file(argv[i], ios::binary);
+    if (!file) {
+      cout << "Can't open " << argv[i] << endl;
+      return 1;
+    }
+    string line;
+    while (getline(file, line))
+      lines.push_back(line);
+  }
+  if (lines.empty()) {
+    cout << "Usage: runtime-output-parser-test [--mutations N] file1.txt [file2.txt ...]" << endl;
+    return 1;
+  }
+
+  // Add random mutations of the sample lines, with a fixed seed so that a failure can be repeated.
+  mt19937 random(1);
+  const string alphabet = "0123456789 .:()[]|,-a>\r";
+  size_t nSampleLines = lines.size();
+  for (int i = 0; i < nMutations; ++i) {
+    string line = lines[random() % nSampleLines];
+    if (line.empty())
+      continue;
+    size_t position = random() % line.size();
+    switch (random() % 5) {
+    case 0: line.erase(position, 1 + random() % 3); break;
+    case 1: line.insert(position, 1, alphabet[random() % alphabet.size()]); break;
+    case 2: line[position] = alphabet[random() % alphabet.size()]; break;
+    // Insert many digits so that a number may be out of range for the original conversion.
+    case 3: line.insert(position, 10 + random() % 15, '9'); break;
+    default: line = line.substr(0, position);
+    }
+    lines.push_back(line);
+  }
+
+  int nDifferences = 0;
+  for (auto line = lines.begin(); line != lines.end(); ++line) {
+    if (!compareLine(*line))
+      ++nDifferences;
+  }
+
+  vector<unique_ptr<TestEvent> > expectedStartupEvents;
+  vector<unique_ptr<TestEvent> > expectedEvents;
+  addEventsWithRegex(lines, expectedStartupEvents, expectedEvents);
+
+  string runtimeOutput;
+  for (auto line = lines.begin(); line != lines.end(); ++line)
+    runtimeOutput += *line + "\n";
+  const size_t chunkCounts[] = { 1, 2, 3, 16 };
+  for (size_t nChunks : chunkCounts) {
+    vector<unique_ptr<TestEvent> > startupEvents;
+    vector<unique_ptr<TestEvent> > events;
+    addEventsWithParser(runtimeOutput, nChunks, startupEvents, events);
+    string name = " with " + to_string(nChunks) + " chunks";
+    if (!compareEvents("startup events" + name, expectedStartupEvents, startupEvents))
+      ++nDifferences;
+    if (!compareEvents("events" + name, expectedEvents, events))
+      ++nDifferences;
+  }
+
+  cout << lines.size() << " lines, " << expectedStartupEvents.size() << " startup events, " <<
+    expectedEvents.size() << " events, " << nDifferences << " differences" << endl;
+  return nDifferences == 0 ? 0 : 1;
+}